@@ -0,0 +1,12 @@
+#pragma once
+
+#include "Usings.h"
+
+// equilibrium of a call auction; volume_ == 0 means the book doesn't cross and price_ is meaningless
+struct AuctionResult
+{
+    Price price_;
+    Quantity volume_;
+    // bid quantity minus ask quantity eligible at price_; positive means buyers are left over
+    std::int64_t imbalance_;
+};
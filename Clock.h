@@ -0,0 +1,15 @@
+#pragma once
+
+#include <chrono>
+#include <functional>
+
+#include "Usings.h"
+
+// where a matching thread gets "now" from; swap in a simulated clock to drive expiry deterministically
+using Clock = std::function<Timestamp()>;
+
+inline Timestamp SystemClockNow()
+{
+    using namespace std::chrono;
+    return duration_cast<nanoseconds>(system_clock::now().time_since_epoch()).count();
+}
@@ -1,10 +1,15 @@
 #pragma once
 
 #include <limits>
+#include <cstddef>
 
 #include "Usings.h"
 
 struct Constants
 {
     static const Price InvalidPrice = std::numeric_limits<Price>::quiet_NaN();
+    // orders without an owner never count as a self-match
+    static constexpr OwnerId NoOwner = 0;
+    // keeps data written by different threads on different cache lines
+    static constexpr std::size_t CacheLineSize = 64;
 };
\ No newline at end of file
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// cheapest timestamp the cpu offers: rdtsc on x86, the virtual counter on arm64, steady_clock elsewhere
+// only differences between two reads on the same thread mean anything
+inline std::uint64_t ReadCycles()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#elif defined(__aarch64__)
+    std::uint64_t ticks;
+    asm volatile("mrs %0, cntvct_el0" : "=r"(ticks));
+    return ticks;
+#else
+    return static_cast<std::uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+}
+
+// measures the cycle counter against steady_clock for roughly `sample`; use it to turn cycle histograms into time
+inline double CyclesPerNanosecond(std::chrono::nanoseconds sample = std::chrono::milliseconds{20})
+{
+    auto start = std::chrono::steady_clock::now();
+    std::uint64_t startCycles = ReadCycles();
+    while (std::chrono::steady_clock::now() - start < sample)
+        ;
+    std::uint64_t cycles = ReadCycles() - startCycles;
+    auto elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    return static_cast<double>(cycles) / elapsed;
+}
@@ -0,0 +1,86 @@
+#include "EventLog.h"
+
+#include <cstring>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+EventLogWriter::EventLogWriter(const std::string& path)
+    : file_{std::fopen(path.c_str(), "wb")}
+{
+    if(!file_) {
+        throw std::runtime_error("cannot open event log for writing: " + path);
+    }
+    //a big stdio buffer turns the appends into large sequential writes
+    std::setvbuf(file_, nullptr, _IOFBF, 1 << 20);
+
+    EventLogHeader header{};
+    std::memcpy(header.magic_, EventLogMagic, sizeof(header.magic_));
+    header.version_ = EventLogVersion;
+    header.recordSize_ = sizeof(EventRecord);
+    if(std::fwrite(&header, sizeof(header), 1, file_) != 1) {
+        throw std::runtime_error("cannot write event log header: " + path);
+    }
+}
+
+EventLogWriter::~EventLogWriter()
+{
+    std::fclose(file_);
+}
+
+void EventLogWriter::Append(const EventRecord& record)
+{
+    if(std::fwrite(&record, sizeof(record), 1, file_) != 1) {
+        throw std::runtime_error("event log write failed");
+    }
+}
+
+void EventLogWriter::Flush()
+{
+    std::fflush(file_);
+}
+
+EventLogReader::EventLogReader(const std::string& path)
+{
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if(fd < 0) {
+        throw std::runtime_error("cannot open event log: " + path);
+    }
+
+    struct stat info{};
+    if(::fstat(fd, &info) != 0 || static_cast<std::size_t>(info.st_size) < sizeof(EventLogHeader)) {
+        ::close(fd);
+        throw std::runtime_error("event log too short: " + path);
+    }
+
+    mappingSize_ = static_cast<std::size_t>(info.st_size);
+    mapping_ = ::mmap(nullptr, mappingSize_, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if(mapping_ == MAP_FAILED) {
+        mapping_ = nullptr;
+        throw std::runtime_error("cannot map event log: " + path);
+    }
+    //we stream front to back exactly once, so let the kernel read ahead aggressively
+    ::madvise(mapping_, mappingSize_, MADV_SEQUENTIAL);
+
+    const auto* header = static_cast<const EventLogHeader*>(mapping_);
+    if(std::memcmp(header->magic_, EventLogMagic, sizeof(header->magic_)) != 0 || header->version_ != EventLogVersion || header->recordSize_ != sizeof(EventRecord)) {
+        ::munmap(mapping_, mappingSize_);
+        mapping_ = nullptr;
+        throw std::runtime_error("not an event log (or a different version): " + path);
+    }
+
+    //a torn last record from a crashed writer is ignored rather than read half-way
+    std::size_t count = (mappingSize_ - sizeof(EventLogHeader)) / sizeof(EventRecord);
+    records_ = std::span<const EventRecord>{reinterpret_cast<const EventRecord*>(static_cast<const char*>(mapping_) + sizeof(EventLogHeader)), count};
+}
+
+EventLogReader::~EventLogReader()
+{
+    if(mapping_) {
+        ::munmap(mapping_, mappingSize_);
+    }
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <bit>
+#include <cstdint>
+#include <cstdio>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+#include "OrderCommand.h"
+#include "SelfMatchPolicy.h"
+#include "TradingPhase.h"
+
+static_assert(std::endian::native == std::endian::little, "event logs are little-endian on disk");
+
+// one command as it sits on disk: fixed width, no varints, no pointers, so reading it is a load rather than a parse
+struct EventRecord
+{
+    Timestamp timestamp_;
+    OrderId orderId_;
+    Price price_;
+    Quantity quantity_;
+    std::uint8_t commandType_;
+    std::uint8_t orderType_;
+    std::uint8_t side_;
+    std::uint8_t reserved_;
+    OwnerId ownerId_;
+    Quantity peakQuantity_;
+    Price stopPrice_;
+
+    static EventRecord FromCommand(Timestamp timestamp, const OrderCommand &command)
+    {
+        return EventRecord{
+            timestamp,
+            command.orderId_,
+            command.price_,
+            command.quantity_,
+            static_cast<std::uint8_t>(command.type_),
+            static_cast<std::uint8_t>(command.orderType_),
+            static_cast<std::uint8_t>(command.side_),
+            0,
+            command.ownerId_,
+            command.peakQuantity_,
+            command.stopPrice_,
+        };
+    }
+
+    // throws std::runtime_error if an enum byte (or a session command's phase or policy) is out of range, since casting
+    // it would hand the book a value none of its switches handle
+    OrderCommand ToCommand() const
+    {
+        if (commandType_ > static_cast<std::uint8_t>(CommandType::SetReferencePrice) || side_ > static_cast<std::uint8_t>(Side::Sell)
+            || orderType_ > static_cast<std::uint8_t>(OrderType::StopLimit))
+            throw std::runtime_error("event log: bad command type, side or order type");
+        if (commandType_ == static_cast<std::uint8_t>(CommandType::Uncross) && orderId_ > static_cast<OrderId>(TradingPhase::Closed))
+            throw std::runtime_error("event log: bad Uncross phase");
+        if (commandType_ == static_cast<std::uint8_t>(CommandType::SetSelfMatchPolicy) && orderId_ > static_cast<OrderId>(SelfMatchPolicy::DecrementBoth))
+            throw std::runtime_error("event log: bad self-match policy");
+        return OrderCommand{
+            static_cast<CommandType>(commandType_),
+            static_cast<OrderType>(orderType_),
+            static_cast<Side>(side_),
+            orderId_,
+            price_,
+            quantity_,
+            ownerId_,
+            peakQuantity_,
+            stopPrice_,
+        };
+    }
+};
+
+static_assert(sizeof(EventRecord) == 40 && std::is_trivially_copyable_v<EventRecord>);
+
+// 16 bytes at the front of every log, so records stay 8-byte aligned in a mapping
+struct EventLogHeader
+{
+    char magic_[8];
+    std::uint32_t version_;
+    std::uint32_t recordSize_;
+};
+
+static_assert(sizeof(EventLogHeader) == 16);
+
+constexpr char EventLogMagic[8] = {'O', 'B', 'E', 'V', 'L', 'O', 'G', '\0'};
+// 2: records grew to 40 bytes for icebergs' peak quantity
+constexpr std::uint32_t EventLogVersion = 2;
+
+// buffered appender; throws std::runtime_error if the file can't be written
+class EventLogWriter
+{
+public:
+    explicit EventLogWriter(const std::string &path);
+    ~EventLogWriter();
+
+    EventLogWriter(const EventLogWriter &) = delete;
+    EventLogWriter &operator=(const EventLogWriter &) = delete;
+
+    void Append(const EventRecord &record);
+    void Flush();
+
+private:
+    std::FILE *file_;
+};
+
+// maps a whole log read-only and hands out the records in place; throws std::runtime_error on a bad file
+class EventLogReader
+{
+public:
+    explicit EventLogReader(const std::string &path);
+    ~EventLogReader();
+
+    EventLogReader(const EventLogReader &) = delete;
+    EventLogReader &operator=(const EventLogReader &) = delete;
+
+    std::span<const EventRecord> Records() const { return records_; }
+
+private:
+    void *mapping_{nullptr};
+    std::size_t mappingSize_{0};
+    std::span<const EventRecord> records_;
+};
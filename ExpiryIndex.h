@@ -0,0 +1,68 @@
+#pragma once
+
+#include <map>
+
+#include "OrderPool.h"
+
+// orders that expire, grouped into one intrusive list per expiry time
+// every GoodForDay order shares the session end, so in practice this is one list per day, and expiring walks
+// only the orders that are due instead of scanning the whole book
+class ExpiryIndex
+{
+public:
+    void Add(OrderPool &pool, OrderHandle handle, Timestamp expiry)
+    {
+        auto &node = pool.Cold(handle);
+        auto &list = lists_[expiry];
+        node.expiry_ = expiry;
+        node.expiryPrev_ = list.tail_;
+        node.expiryNext_ = InvalidOrderHandle;
+        if (list.tail_ == InvalidOrderHandle)
+            list.head_ = handle;
+        else
+            pool.Cold(list.tail_).expiryNext_ = handle;
+        list.tail_ = handle;
+    }
+
+    // O(1) unless the order was the head or tail of its list; a no-op for orders that never expire
+    void Remove(OrderPool &pool, OrderHandle handle)
+    {
+        auto &node = pool.Cold(handle);
+        if (node.expiry_ == NoExpiry)
+            return;
+
+        if (node.expiryPrev_ == InvalidOrderHandle || node.expiryNext_ == InvalidOrderHandle)
+        {
+            auto it = lists_.find(node.expiry_);
+            auto &list = it->second;
+            if (node.expiryPrev_ == InvalidOrderHandle)
+                list.head_ = node.expiryNext_;
+            if (node.expiryNext_ == InvalidOrderHandle)
+                list.tail_ = node.expiryPrev_;
+            if (list.head_ == InvalidOrderHandle)
+                lists_.erase(it);
+        }
+        if (node.expiryPrev_ != InvalidOrderHandle)
+            pool.Cold(node.expiryPrev_).expiryNext_ = node.expiryNext_;
+        if (node.expiryNext_ != InvalidOrderHandle)
+            pool.Cold(node.expiryNext_).expiryPrev_ = node.expiryPrev_;
+
+        node.expiryPrev_ = node.expiryNext_ = InvalidOrderHandle;
+        node.expiry_ = NoExpiry;
+    }
+
+    bool Empty() const { return lists_.empty(); }
+    bool Due(Timestamp now) const { return !lists_.empty() && lists_.begin()->first <= now; }
+
+    // the next due order; the caller has to take it out of the index (e.g. by cancelling it) before asking again
+    OrderHandle NextDue() const { return lists_.begin()->second.head_; }
+
+private:
+    struct ExpiryList
+    {
+        OrderHandle head_{InvalidOrderHandle};
+        OrderHandle tail_{InvalidOrderHandle};
+    };
+
+    std::map<Timestamp, ExpiryList> lists_;
+};
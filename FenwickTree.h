@@ -0,0 +1,35 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// binary indexed tree over a fixed number of slots: point add and prefix sum, both O(log n)
+class FenwickTree
+{
+public:
+    FenwickTree() = default;
+
+    explicit FenwickTree(std::size_t size)
+        : tree_(size + 1, 0)
+    {
+    }
+
+    void Add(std::size_t index, std::int64_t delta)
+    {
+        for (++index; index < tree_.size(); index += index & (~index + 1))
+            tree_[index] += delta;
+    }
+
+    // sum of slots [0, index]
+    std::int64_t Prefix(std::size_t index) const
+    {
+        std::int64_t sum = 0;
+        for (++index; index > 0; index -= index & (~index + 1))
+            sum += tree_[index];
+        return sum;
+    }
+
+private:
+    std::vector<std::int64_t> tree_;
+};
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <cstddef>
+
+// log-linear (HDR-style) histogram of unsigned values: exact below 32, then 16 buckets per power of two,
+// so any recorded value is known to within ~6% over the whole 64-bit range in a fixed 8KB
+// one thread records; any other thread may read at the same time without locks. a concurrent read can be a few
+// records behind, never torn
+class Histogram
+{
+public:
+    void Record(std::uint64_t value)
+    {
+        Bump(buckets_[BucketOf(value)]);
+        if (value > max_.load(std::memory_order_relaxed))
+            max_.store(value, std::memory_order_relaxed);
+    }
+
+    std::uint64_t Count() const
+    {
+        std::uint64_t count = 0;
+        for (const auto &bucket : buckets_)
+            count += bucket.load(std::memory_order_relaxed);
+        return count;
+    }
+
+    std::uint64_t Max() const { return max_.load(std::memory_order_relaxed); }
+
+    // smallest bucket bound that at least q of the recorded values fall under (q in [0, 1])
+    std::uint64_t Percentile(double q) const
+    {
+        std::uint64_t total = Count();
+        if (total == 0)
+            return 0;
+
+        std::uint64_t rank = static_cast<std::uint64_t>(q * static_cast<double>(total - 1)) + 1;
+        std::uint64_t seen = 0;
+        for (std::size_t index = 0; index < BucketCount; ++index)
+        {
+            seen += buckets_[index].load(std::memory_order_relaxed);
+            // upper edge of the bucket, but never above what was actually seen
+            if (seen >= rank)
+                return index + 1 < BucketCount ? std::min(LowerBound(index + 1) - 1, Max()) : Max();
+        }
+        return Max();
+    }
+
+private:
+    static constexpr unsigned SubBucketBits = 4;
+    static constexpr std::uint64_t SubBuckets = std::uint64_t{1} << SubBucketBits;
+    // values below 2 * SubBuckets get a bucket each; above that each power of two splits into SubBuckets
+    static constexpr std::size_t BucketCount = (64 - SubBucketBits) * SubBuckets + 2 * SubBuckets;
+
+    static std::size_t BucketOf(std::uint64_t value)
+    {
+        if (value < 2 * SubBuckets)
+            return static_cast<std::size_t>(value);
+        unsigned shift = static_cast<unsigned>(std::bit_width(value)) - SubBucketBits - 1;
+        return static_cast<std::size_t>(shift * SubBuckets + (value >> shift));
+    }
+
+    static std::uint64_t LowerBound(std::size_t index)
+    {
+        if (index < 2 * SubBuckets)
+            return index;
+        unsigned shift = static_cast<unsigned>(index / SubBuckets) - 1;
+        return (index - shift * SubBuckets) << shift;
+    }
+
+    // single writer, so a plain load + store is enough; no locked read-modify-write on the hot path
+    static void Bump(std::atomic<std::uint64_t> &counter)
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    std::array<std::atomic<std::uint64_t>, BucketCount> buckets_{};
+    std::atomic<std::uint64_t> max_{0};
+};
@@ -0,0 +1,123 @@
+#include "Journal.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+    void WriteAll(int fd, const void* data, std::size_t size)
+    {
+        const char* bytes = static_cast<const char*>(data);
+        while(size > 0) {
+            ssize_t written = ::write(fd, bytes, size);
+            if(written < 0) {
+                if(errno == EINTR) {
+                    continue;
+                }
+                throw std::runtime_error(std::string{"journal write failed: "} + std::strerror(errno));
+            }
+            bytes += written;
+            size -= static_cast<std::size_t>(written);
+        }
+    }
+
+    void SyncData(int fd)
+    {
+#if defined(__APPLE__)
+        int result = ::fsync(fd);
+#else
+        int result = ::fdatasync(fd);
+#endif
+        if(result != 0) {
+            throw std::runtime_error(std::string{"journal sync failed: "} + std::strerror(errno));
+        }
+    }
+}
+
+Journal::Journal(const std::string& path, std::size_t groupSize)
+    : groupSize_{groupSize == 0 ? 1 : groupSize}
+{
+    fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_APPEND, 0644);
+    if(fd_ < 0) {
+        throw std::runtime_error("cannot open journal: " + path);
+    }
+
+    struct stat info{};
+    if(::fstat(fd_, &info) != 0) {
+        ::close(fd_);
+        throw std::runtime_error("cannot stat journal: " + path);
+    }
+
+    EventLogHeader expected{};
+    std::memcpy(expected.magic_, EventLogMagic, sizeof(expected.magic_));
+    expected.version_ = EventLogVersion;
+    expected.recordSize_ = sizeof(EventRecord);
+
+    //the header is written and synced before any record, so a file shorter than it is a creation that crashed part
+    //way and holds no records; it starts over, as long as what is there is the start of our header
+    const std::size_t size = static_cast<std::size_t>(info.st_size);
+    EventLogHeader header{};
+    bool fresh = size < sizeof(EventLogHeader);
+    if(::pread(fd_, &header, std::min(size, sizeof(header)), 0) != static_cast<ssize_t>(std::min(size, sizeof(header)))
+        || std::memcmp(&header, &expected, std::min(size, sizeof(header))) != 0) {
+        ::close(fd_);
+        throw std::runtime_error("not a journal (or a different version): " + path);
+    }
+
+    if(fresh) {
+        if(size != 0 && ::ftruncate(fd_, 0) != 0) {
+            ::close(fd_);
+            throw std::runtime_error("cannot reset journal: " + path);
+        }
+        WriteAll(fd_, &expected, sizeof(expected));
+        SyncData(fd_);
+    }
+    else {
+        //a torn record left by a crash is dropped; the next append lands after the last whole record
+        std::size_t records = (size - sizeof(EventLogHeader)) / sizeof(EventRecord);
+        std::size_t whole = sizeof(EventLogHeader) + records * sizeof(EventRecord);
+        if(whole != size && ::ftruncate(fd_, static_cast<off_t>(whole)) != 0) {
+            ::close(fd_);
+            throw std::runtime_error("cannot trim journal: " + path);
+        }
+        sequence_ = records;
+    }
+
+    pending_.reserve(groupSize_);
+}
+
+Journal::~Journal()
+{
+    try {
+        Commit();
+    }
+    catch(...) {
+    }
+    ::close(fd_);
+}
+
+void Journal::Append(Timestamp timestamp, const OrderCommand& command)
+{
+    pending_.push_back(EventRecord::FromCommand(timestamp, command));
+    ++sequence_;
+    if(pending_.size() >= groupSize_) {
+        Commit();
+    }
+}
+
+void Journal::Commit()
+{
+    if(pending_.empty()) {
+        return;
+    }
+    WriteAll(fd_, pending_.data(), pending_.size() * sizeof(EventRecord));
+    SyncData(fd_);
+    pending_.clear();
+    ++commits_;
+}
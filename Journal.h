@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "EventLog.h"
+
+// write-ahead journal of the commands the book accepted, in the event log format so replay can read it directly
+// records are buffered and made durable together (one write + fdatasync per group) instead of one sync per command
+// throws std::runtime_error on I/O failure: if we can't journal we must not keep matching
+class Journal
+{
+public:
+    // appends to an existing journal (continuing its sequence, minus any torn last record) or starts a new one;
+    // throws if the file is something else or a journal of another version
+    Journal(const std::string &path, std::size_t groupSize = 1024);
+    ~Journal();
+
+    Journal(const Journal &) = delete;
+    Journal &operator=(const Journal &) = delete;
+
+    // commits on its own once a full group is buffered
+    void Append(Timestamp timestamp, const OrderCommand &command);
+    // write + fdatasync whatever is buffered; a no-op if nothing is
+    void Commit();
+
+    // number of records in the journal, committed or not; a snapshot taken now covers exactly this many
+    std::uint64_t Sequence() const { return sequence_; }
+    std::uint64_t CommitCount() const { return commits_; }
+
+private:
+    int fd_{-1};
+    std::size_t groupSize_;
+    std::vector<EventRecord> pending_;
+    std::uint64_t sequence_{0};
+    std::uint64_t commits_{0};
+};
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// the csv rows benchmark and orderentry print, so their results can be concatenated and compared
+inline void PrintReportHeader()
+{
+    std::printf("benchmark,param,samples,ops_per_s,p50_ns,p90_ns,p99_ns,p999_ns,max_ns\n");
+}
+
+// per-operation samples in nanoseconds (sorted in place); wall time is measured separately so ops_per_s excludes setup
+inline void Report(const char *name, const std::string &param, std::vector<double> &samples, double wallNs)
+{
+    if (samples.empty())
+        return;
+    std::sort(samples.begin(), samples.end());
+    auto percentile = [&samples](double q)
+    {
+        return samples[std::min(samples.size() - 1, static_cast<std::size_t>(q * samples.size()))];
+    };
+    std::printf("%s,%s,%zu,%.0f,%.0f,%.0f,%.0f,%.0f,%.0f\n", name, param.c_str(), samples.size(),
+                wallNs > 0 ? samples.size() * 1e9 / wallNs : 0.0,
+                percentile(0.50), percentile(0.90), percentile(0.99), percentile(0.999), samples.back());
+}
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cstdint>
+
 #include "Usings.h"
 
 // gets information about the state of the order book
@@ -7,6 +9,7 @@ struct LevelInfo
 {
     Price price_;
     Quantity quantity_;
+    std::uint32_t count_{0};
 };
 
 using LevelInfos = std::vector<LevelInfo>;
\ No newline at end of file
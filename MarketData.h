@@ -0,0 +1,176 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <optional>
+#include <type_traits>
+#include <span>
+#include <vector>
+
+#include "Usings.h"
+#include "Side.h"
+#include "PriceLevel.h"
+
+enum class LevelAction : std::uint8_t
+{
+    New,
+    Change,
+    Delete,
+};
+
+// market-by-price: a level's aggregate state after a command; quantity and count are 0 on Delete
+struct LevelUpdate
+{
+    std::uint64_t sequence_;
+    Price price_;
+    Quantity quantity_;
+    std::uint32_t count_;
+    Side side_;
+    LevelAction action_;
+};
+
+// either the coalesced level changes of one command, or a full-depth snapshot (every level as New, bids best
+// first then asks). a snapshot is the book as of sequence_: rebuild from it, then apply updates with a higher sequence
+struct MarketDataMessage
+{
+    bool snapshot_;
+    // sequence of the last update the message includes
+    std::uint64_t sequence_;
+    std::span<const LevelUpdate> updates_;
+};
+
+// non-owning reference to anything callable with a MarketDataMessage, the same shape as TradeSink
+class MarketDataSink
+{
+public:
+    template<typename Fn>
+        requires(!std::is_same_v<std::remove_cvref_t<Fn>, MarketDataSink>)
+    MarketDataSink(Fn &fn)
+        : context_{&fn}, emit_{[](void *context, const MarketDataMessage &message) { (*static_cast<Fn *>(context))(message); }}
+    {
+    }
+
+    void operator()(const MarketDataMessage &message) const { emit_(context_, message); }
+
+private:
+    void *context_;
+    void (*emit_)(void *, const MarketDataMessage &);
+};
+
+// turns the book's level changes into incremental updates. the book reports each level (with its state at that
+// moment) before changing it; when the outermost command finishes, every touched level is compared with how it
+// looks now and one update per level that really changed goes out, so publishing costs O(changed levels)
+// does nothing (and touches nothing) until a sink is attached
+class MarketDataFeed
+{
+public:
+    void Attach(MarketDataSink sink, std::uint64_t snapshotInterval, std::size_t capacity)
+    {
+        sink_ = sink;
+        snapshotInterval_ = snapshotInterval;
+        touched_.reserve(capacity);
+        updates_.reserve(capacity);
+    }
+
+    bool Enabled() const { return sink_.has_value(); }
+    std::uint64_t Sequence() const { return sequence_; }
+
+    void Touch(Side side, Price price, const PriceLevel &level)
+    {
+        if (!sink_)
+            return;
+        // the same level twice in a row (add then match, say) is by far the common repeat
+        if (!touched_.empty() && touched_.back().side_ == side && touched_.back().price_ == price)
+            return;
+        touched_.push_back(Touched{side, price, level.quantity_, level.count_});
+    }
+
+    // commands nest (a modify is a cancel plus an add), so only the outermost one publishes
+    void BeginCommand() { ++depth_; }
+    bool EndCommand() { return --depth_ == 0; }
+    // between BeginCommand and EndCommand: no other command encloses this one
+    bool Outermost() const { return depth_ == 1; }
+
+    template<typename Bids, typename Asks>
+    void Flush(const Bids &bids, const Asks &asks)
+    {
+        if (!sink_)
+            return;
+
+        if (!touched_.empty())
+        {
+            // keep the first touch of each level: that one saw the level as it was before the command
+            std::stable_sort(touched_.begin(), touched_.end(), [](const Touched &lhs, const Touched &rhs) {
+                return lhs.side_ != rhs.side_ ? lhs.side_ < rhs.side_ : lhs.price_ < rhs.price_;
+            });
+            updates_.clear();
+            for (std::size_t i = 0; i < touched_.size(); ++i)
+            {
+                const auto &touch = touched_[i];
+                if (i > 0 && touched_[i - 1].side_ == touch.side_ && touched_[i - 1].price_ == touch.price_)
+                    continue;
+                const PriceLevel *level = touch.side_ == Side::Buy ? bids.Find(touch.price_) : asks.Find(touch.price_);
+                Emit(touch, level && !level->Empty() ? level : nullptr);
+            }
+            touched_.clear();
+            if (!updates_.empty())
+                (*sink_)(MarketDataMessage{false, sequence_, updates_});
+        }
+
+        if (snapshotInterval_ != 0 && ++commands_ % snapshotInterval_ == 0)
+            PublishSnapshot(bids, asks);
+    }
+
+    template<typename Bids, typename Asks>
+    void PublishSnapshot(const Bids &bids, const Asks &asks)
+    {
+        if (!sink_)
+            return;
+        snapshot_.clear();
+        bids.ForEach([this](Price price, const PriceLevel &level) {
+            snapshot_.push_back(LevelUpdate{sequence_, price, level.quantity_, level.count_, Side::Buy, LevelAction::New});
+        });
+        asks.ForEach([this](Price price, const PriceLevel &level) {
+            snapshot_.push_back(LevelUpdate{sequence_, price, level.quantity_, level.count_, Side::Sell, LevelAction::New});
+        });
+        (*sink_)(MarketDataMessage{true, sequence_, snapshot_});
+    }
+
+private:
+    struct Touched
+    {
+        Side side_;
+        Price price_;
+        Quantity quantityBefore_;
+        std::uint32_t countBefore_;
+    };
+
+    void Emit(const Touched &touch, const PriceLevel *level)
+    {
+        bool existed = touch.countBefore_ != 0;
+        if (!existed && !level)
+            return;
+        if (existed && level && level->quantity_ == touch.quantityBefore_ && level->count_ == touch.countBefore_)
+            return;
+
+        LevelAction action = !existed ? LevelAction::New : level ? LevelAction::Change : LevelAction::Delete;
+        updates_.push_back(LevelUpdate{
+            ++sequence_,
+            touch.price_,
+            level ? level->quantity_ : 0,
+            level ? level->count_ : 0,
+            touch.side_,
+            action,
+        });
+    }
+
+    std::optional<MarketDataSink> sink_;
+    std::uint64_t snapshotInterval_{0};
+    std::uint64_t commands_{0};
+    std::uint64_t sequence_{0};
+    int depth_{0};
+    // scratch reused by every command, so publishing doesn't allocate once these have grown
+    std::vector<Touched> touched_;
+    std::vector<LevelUpdate> updates_;
+    std::vector<LevelUpdate> snapshot_;
+};
@@ -0,0 +1,126 @@
+#include "MatchingThread.h"
+
+#include <sys/wait.h>
+
+#include "ThreadAffinity.h"
+#include "Snapshot.h"
+
+namespace
+{
+    // commands taken from one ring before moving to the next, so a busy gateway can't starve the others
+    constexpr std::size_t DrainBatch = 64;
+}
+
+MatchingThread::MatchingThread(std::size_t producerCount, std::size_t ringCapacity, LadderBand band, std::size_t orderCapacity)
+    : book_{band, orderCapacity}, trades_{ringCapacity}
+{
+    ingress_.reserve(producerCount);
+    for(std::size_t i = 0; i < producerCount; ++i) {
+        ingress_.push_back(std::make_unique<SpscRing<OrderCommand>>(ringCapacity));
+    }
+}
+
+MatchingThread::~MatchingThread()
+{
+    Stop();
+}
+
+void MatchingThread::Start(int cpu)
+{
+    stop_.store(false, std::memory_order_release);
+    thread_ = std::thread{[this, cpu] {
+        PinCurrentThread(cpu);
+        Run();
+    }};
+}
+
+void MatchingThread::Stop()
+{
+    if(!thread_.joinable()) {
+        return;
+    }
+    stop_.store(true, std::memory_order_release);
+    thread_.join();
+    if(snapshotChild_ > 0) {
+        ::waitpid(snapshotChild_, nullptr, 0);
+        snapshotChild_ = -1;
+    }
+}
+
+void MatchingThread::Run()
+{
+    while(true) {
+        //expiry runs here on the matching thread's own clock, so nothing else ever has to lock the book
+        //commands are journaled with the same timestamp, so replaying the journal expires the same orders
+        Timestamp now = clock_();
+        book_.ExpireOrders(now);
+
+        if(DrainOnce(now)) {
+            MaybeSnapshot();
+            continue;
+        }
+        //only leave once a full pass found every ring empty, so nothing pushed before Stop is lost
+        if(stop_.load(std::memory_order_acquire) && !DrainOnce(now)) {
+            return;
+        }
+        CpuRelax();
+    }
+}
+
+bool MatchingThread::DrainOnce(Timestamp now)
+{
+    //with a journal, trades wait until the commands behind them are durable; publishing first could show fills
+    //that a crash before the sync would then take back
+    auto publish = [this](const Trade& trade) {
+        if(journal_) {
+            pendingTrades_.push_back(trade);
+        }
+        else {
+            trades_.Push(trade);
+        }
+    };
+    TradeSink sink{publish};
+
+    std::uint64_t processed = 0;
+    OrderCommand command;
+    for(auto& ring : ingress_) {
+        for(std::size_t i = 0; i < DrainBatch && ring->TryPop(command); ++i) {
+            if(journal_) {
+                journal_->Append(now, command);
+            }
+            book_.Apply(command, sink);
+            ++processed;
+        }
+    }
+
+    if(processed && journal_) {
+        //one write + sync for the whole pass
+        journal_->Commit();
+        for(const auto& trade : pendingTrades_) {
+            trades_.Push(trade);
+        }
+        pendingTrades_.clear();
+    }
+    if(processed) {
+        commandsProcessed_.fetch_add(processed, std::memory_order_relaxed);
+    }
+    return processed != 0;
+}
+
+void MatchingThread::MaybeSnapshot()
+{
+    if(!journal_ || snapshotInterval_ == 0) {
+        return;
+    }
+    if(snapshotChild_ > 0) {
+        if(::waitpid(snapshotChild_, nullptr, WNOHANG) == 0) {
+            return;
+        }
+        snapshotChild_ = -1;
+    }
+    //the journal was just committed, so the snapshot never covers records that aren't durable yet
+    if(journal_->Sequence() - lastSnapshot_ >= snapshotInterval_) {
+        lastSnapshot_ = journal_->Sequence();
+        snapshotChild_ = ForkSnapshot(book_, lastSnapshot_, snapshotPath_);
+    }
+}
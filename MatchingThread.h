@@ -0,0 +1,84 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <cstdint>
+#include <string>
+
+#include <sys/types.h>
+
+#include "Orderbook.h"
+#include "OrderCommand.h"
+#include "SpscRing.h"
+#include "Clock.h"
+#include "Journal.h"
+
+// ingestion mode: one thread owns the book and is the only one that touches it
+// every gateway thread gets its own SPSC ring to push commands into, and trades come back out on one outbound ring,
+// so there is no mutex anywhere between a gateway and the match loop
+class MatchingThread
+{
+public:
+    MatchingThread(std::size_t producerCount, std::size_t ringCapacity, LadderBand band = {}, std::size_t orderCapacity = 0);
+    ~MatchingThread();
+
+    MatchingThread(const MatchingThread &) = delete;
+    MatchingThread &operator=(const MatchingThread &) = delete;
+
+    // set before Start; the thread reads it between drain passes to expire GoodForDay orders
+    void SetClock(Clock clock) { clock_ = std::move(clock); }
+    // set before Start; every command is journaled before it is applied, and each drain pass is one group commit
+    // the pass's trades reach Outbound only once that commit has synced
+    void SetJournal(Journal *journal)
+    {
+        journal_ = journal;
+        pendingTrades_.reserve(trades_.Capacity());
+    }
+    // set before Start (needs a journal); every `interval` commands a forked child writes a snapshot to `path`
+    void SetSnapshots(std::string path, std::uint64_t interval)
+    {
+        snapshotPath_ = std::move(path);
+        snapshotInterval_ = interval;
+    }
+
+    // cpu < 0 leaves the thread unpinned
+    void Start(int cpu = -1);
+    // drains whatever is already queued, then joins
+    void Stop();
+
+    // each producer thread must use exactly one of these and never share it
+    SpscRing<OrderCommand> &Ingress(std::size_t producer) { return *ingress_[producer]; }
+    // trades in match order; someone has to keep draining it or the matcher stalls when it fills up
+    SpscRing<Trade> &Outbound() { return trades_; }
+
+    std::uint64_t CommandsProcessed() const { return commandsProcessed_.load(std::memory_order_relaxed); }
+    // safe from any thread while the matcher runs; never stalls it
+    TopOfBook GetTopOfBook() const { return book_.GetTopOfBook(); }
+
+    // only safe while the thread is stopped. with a journal, change the phase or the session settings by pushing
+    // session commands (OrderCommand::Session) instead, or recovery won't see the change
+    Orderbook &Book() { return book_; }
+    const Orderbook &Book() const { return book_; }
+
+private:
+    void Run();
+    bool DrainOnce(Timestamp now);
+    void MaybeSnapshot();
+
+    Orderbook book_;
+    std::vector<std::unique_ptr<SpscRing<OrderCommand>>> ingress_;
+    SpscRing<Trade> trades_;
+    // a drain pass's trades, held back until its journal commit
+    std::vector<Trade> pendingTrades_;
+    Clock clock_{SystemClockNow};
+    Journal *journal_{nullptr};
+    std::string snapshotPath_;
+    std::uint64_t snapshotInterval_{0};
+    std::uint64_t lastSnapshot_{0};
+    pid_t snapshotChild_{-1};
+    std::thread thread_;
+    std::atomic<bool> stop_{false};
+    std::atomic<std::uint64_t> commandsProcessed_{0};
+};
@@ -1,6 +1,7 @@
 #pragma once
 
-#include <list>
+#include <algorithm>
+#include <memory>
 #include <exception>
 #include <format>
 
@@ -12,9 +13,16 @@
 class Order
 {
 public:
-    Order(OrderType orderType, OrderId orderId, Side side, Price price, Quantity quantity)
-        : orderType_{orderType}, orderId_{orderId}, side_{side}, price_{price}, initialQuantity_{quantity}, remainingQuantity_{quantity}
+    // peakQuantity only means something for an Iceberg, where 0 shows the whole order; stopPrice only for a Stop or StopLimit
+    Order(OrderType orderType, OrderId orderId, Side side, Price price, Quantity quantity, OwnerId ownerId = Constants::NoOwner, Quantity peakQuantity = 0,
+        Price stopPrice = Constants::InvalidPrice)
+        : orderId_{orderId}, price_{price}, initialQuantity_{quantity}, remainingQuantity_{quantity}, ownerId_{ownerId}, stopPrice_{stopPrice}, orderType_{orderType}, side_{side}
     {
+        if (orderType == OrderType::Iceberg)
+        {
+            peakQuantity_ = peakQuantity == 0 ? quantity : peakQuantity;
+            displayQuantity_ = std::min(peakQuantity_, quantity);
+        }
     }
 
     Order(OrderId orderId, Side side, Quantity quantity)
@@ -25,10 +33,15 @@ public:
     OrderId GetOrderId() const { return orderId_; }
     Side GetSide() const { return side_; }
     Price GetPrice() const { return price_; }
+    Price GetStopPrice() const { return stopPrice_; }
     OrderType GetOrderType() const { return orderType_; }
+    OwnerId GetOwnerId() const { return ownerId_; }
     Quantity GetInitialQuantity() const { return initialQuantity_; }
     Quantity GetRemainingQuantity() const { return remainingQuantity_; }
     Quantity GetFilledQuantity() const { return GetInitialQuantity() - GetRemainingQuantity(); }
+    // the part of the remaining quantity the book shows; short of the remaining quantity only for an Iceberg
+    Quantity GetDisplayQuantity() const { return GetOrderType() == OrderType::Iceberg ? displayQuantity_ : GetRemainingQuantity(); }
+    Quantity GetPeakQuantity() const { return peakQuantity_; }
     bool IsFilled() const { return GetRemainingQuantity() == 0; }
     void Fill(Quantity quantity)
     {
@@ -36,6 +49,15 @@ public:
             throw std::logic_error("Error");
 
         remainingQuantity_ -= quantity;
+        displayQuantity_ = std::min(displayQuantity_, remainingQuantity_);
+    }
+    // sets how much of an iceberg's remaining quantity currently shows, for rebuilding one mid-peak
+    void SetDisplayQuantity(Quantity quantity)
+    {
+        if (GetOrderType() != OrderType::Iceberg || quantity > GetRemainingQuantity() || quantity > peakQuantity_)
+            throw std::logic_error("error");
+
+        displayQuantity_ = quantity;
     }
     void ToGoodTillCancel(Price price)
     {
@@ -47,16 +69,18 @@ public:
     }
 
 private:
-    OrderType orderType_;
+    // widest first, so the one-byte enums share the tail instead of each padding out a word
     OrderId orderId_;
-    Side side_;
     Price price_;
     Quantity initialQuantity_;
     Quantity remainingQuantity_;
+    OwnerId ownerId_;
+    Quantity peakQuantity_{0};
+    Quantity displayQuantity_{0};
+    Price stopPrice_;
+    OrderType orderType_;
+    Side side_;
 };
 
 //
-using OrderPointer = std::shared_ptr<Order>;
-// we use list because list gives iterator that cannot be invalidated regardless of size; this is useful to determine where our order is in the bid or ask book
-// list is dispersed in memeroy while veector is together
-using OrderPointers = std::list<OrderPointer>;
\ No newline at end of file
+using OrderPointer = std::shared_ptr<Order>;
\ No newline at end of file
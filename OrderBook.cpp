@@ -1,184 +1,1039 @@
 #include "Orderbook.h"
 
-#include<numeric>
 #include<chrono>
 #include<ctime>
+#include<algorithm>
+#include<tuple>
+#include<cstdlib>
 
-bool Orderbook::CanMatch(Side side, Price price) const
+template<typename Policy>
+BasicOrderbook<Policy>::BasicOrderbook() = default;
+
+template<typename Policy>
+BasicOrderbook<Policy>::BasicOrderbook(LadderBand band, std::size_t orderCapacity)
+    : pool_{orderCapacity}, bids_{band}, asks_{band}, orders_{orderCapacity}
+{
+}
+
+template<typename Policy>
+bool BasicOrderbook<Policy>::CanMatch(Side side, Price price) const
 {
     if(side == Side::Buy) {
-        if(asks_.empty()) {
+        if(asks_.Empty()) {
             return false;
         }
 
         //check if buy order has price greater than or equal to the best ask
-        const auto& [bestAsk, _] = *asks_.begin();
-        return price >= bestAsk;
+        return price >= asks_.BestPrice();
     }
     else{
-        if(bids_.empty()){
+        if(bids_.Empty()){
             return false;
         }
         //check if sell order has price less than or equal to the best bid
-        const auto& [bestBid, _] = *bids_.begin();
-        return price <= bestBid;
+        return price <= bids_.BestPrice();
     }
 }
 
-Trades Orderbook::MatchOrders() 
+template<typename Policy>
+bool BasicOrderbook<Policy>::CanFullyFill(Side side, Price price, Quantity quantity, OwnerId owner) const
 {
-    Trades trades;
-    trades.reserve(orders_.size());
+    if(!CanMatch(side, price)) {
+        return false;
+    }
 
-    while(true){
-        if(bids_.empty() || asks_.empty()) {
-            break;
+    //depth at or better than our limit on the other side, straight from the ladder's running sums
+    std::int64_t available = side == Side::Buy ? asks_.QuantityAtOrBetter(price) : bids_.QuantityAtOrBetter(price);
+    if(owner == Constants::NoOwner && (available >= quantity || icebergs_ == 0)) {
+        return available >= quantity;
+    }
+    if(available < quantity && icebergs_ == 0) {
+        return false;
+    }
+
+    //the ladder only knows what shows, so hidden reserves mean walking the crossed levels, as do an owned order's
+    //own resting orders, which never fill it
+    std::int64_t own = 0;
+    auto countLevel = [&](Price levelPrice, const PriceLevel& level) {
+        if(side == Side::Buy ? levelPrice > price : levelPrice < price) {
+            return false;
+        }
+        for(OrderHandle handle = level.Front(); handle != InvalidOrderHandle; handle = pool_.Hot(handle).next_) {
+            Quantity hidden = icebergs_ != 0 ? pool_.Cold(handle).reserve_ : 0;
+            available += hidden;
+            if(owner != Constants::NoOwner && pool_.Hot(handle).owner_ == owner) {
+                own += pool_.Hot(handle).remaining_ + hidden;
+            }
         }
-        auto& [bidPrice, bids] = *bids_.begin();
-        auto& [askPrice, asks] = *asks_.begin();
+        return true;
+    };
+    if(side == Side::Buy) {
+        asks_.ForEach(countLevel);
+    }
+    else {
+        bids_.ForEach(countLevel);
+    }
+    //cancelling our resting orders just skips them; the other policies would stop the FOK short of a full fill
+    if(selfMatchPolicy_ == SelfMatchPolicy::CancelResting) {
+        return available - own >= quantity;
+    }
+    return own == 0 && available >= quantity;
+}
 
-        if(bidPrice < askPrice) {
-            break;
+template<typename Policy>
+void BasicOrderbook<Policy>::ReleaseOrder(OrderHandle handle)
+{
+    orders_.Erase(pool_.Hot(handle).orderId_);
+    //fills release orders inside the match loop; skip the cold half entirely when nothing can expire
+    if(!expiries_.Empty()) {
+        expiries_.Remove(pool_, handle);
+    }
+    if(icebergs_ != 0 && pool_.Cold(handle).type_ == OrderType::Iceberg) {
+        --icebergs_;
+    }
+    pool_.Free(handle);
+}
+
+template<typename Policy>
+bool BasicOrderbook<Policy>::Replenish(PriceLevel& level, OrderHandle handle)
+{
+    auto& cold = pool_.Cold(handle);
+    if(cold.reserve_ == 0) {
+        return false;
+    }
+
+    //same node, same id index entry: only the showing quantity and the place in the queue change
+    Quantity peak = std::min(cold.peak_, cold.reserve_);
+    cold.reserve_ -= peak;
+    pool_.Hot(handle).remaining_ = peak;
+    level.PushBack(pool_, handle);
+    if(cold.side_ == Side::Buy) {
+        bids_.OnQuantityChanged(cold.price_, peak);
+    }
+    else {
+        asks_.OnQuantityChanged(cold.price_, peak);
+    }
+    return true;
+}
+
+template<typename Policy>
+Quantity BasicOrderbook<Policy>::HiddenQuantity(const PriceLevel& level) const
+{
+    Quantity hidden = 0;
+    for(OrderHandle handle = level.Front(); handle != InvalidOrderHandle; handle = pool_.Hot(handle).next_) {
+        hidden += pool_.Cold(handle).reserve_;
+    }
+    return hidden;
+}
+
+template<typename Policy>
+void BasicOrderbook<Policy>::LinkStop(OrderHandle handle)
+{
+    const auto& cold = pool_.Cold(handle);
+    if(cold.side_ == Side::Buy) {
+        buyStops_[cold.stopPrice_].PushBack(pool_, handle);
+    }
+    else {
+        sellStops_[cold.stopPrice_].PushBack(pool_, handle);
+    }
+}
+
+template<typename Policy>
+void BasicOrderbook<Policy>::UnlinkStop(OrderHandle handle)
+{
+    const auto& cold = pool_.Cold(handle);
+    if(cold.side_ == Side::Buy) {
+        auto& stops = buyStops_.At(cold.stopPrice_);
+        stops.Erase(pool_, handle);
+        if(stops.Empty()) {
+            buyStops_.Erase(cold.stopPrice_);
         }
+    }
+    else {
+        auto& stops = sellStops_.At(cold.stopPrice_);
+        stops.Erase(pool_, handle);
+        if(stops.Empty()) {
+            sellStops_.Erase(cold.stopPrice_);
+        }
+    }
+}
 
-        while(bids.size() && asks.size()) {
-            auto& bid = bids.front();
-            auto& ask = asks.front();
-            Quantity quantity = std::min(bid->GetRemainingQuantity(), ask->GetRemainingQuantity());
-            bid->Fill(quantity);
-            ask->Fill(quantity);
+template<typename Policy>
+void BasicOrderbook<Policy>::TriggerStops(Price buyPrint, Price sellPrint)
+{
+    //whole levels at a time, so the stops still waiting are never looked at
+    auto trigger = [this](PriceLevel& stops) {
+        while(!stops.Empty()) {
+            OrderHandle handle = stops.PopFront(pool_);
+            const auto& hot = pool_.Hot(handle);
+            const auto& cold = pool_.Cold(handle);
+            if(cold.type_ == OrderType::Stop) {
+                triggered_.push_back(Order{OrderType::Market, hot.orderId_, cold.side_, Constants::InvalidPrice, hot.remaining_, hot.owner_});
+            }
+            else {
+                triggered_.push_back(Order{OrderType::GoodTillCancel, hot.orderId_, cold.side_, cold.price_, hot.remaining_, hot.owner_});
+            }
+            ReleaseOrder(handle);
+        }
+    };
+    while(!buyStops_.Empty() && buyStops_.BestPrice() <= buyPrint) {
+        Price stopPrice = buyStops_.BestPrice();
+        trigger(buyStops_.Best());
+        buyStops_.Erase(stopPrice);
+    }
+    while(!sellStops_.Empty() && sellStops_.BestPrice() >= sellPrint) {
+        Price stopPrice = sellStops_.BestPrice();
+        trigger(sellStops_.Best());
+        sellStops_.Erase(stopPrice);
+    }
+}
 
-            if(bid->IsFilled()) 
-            {
-                bids.pop_front();
-                orders_.erase(bid->GetOrderId());
+template<typename Policy>
+void BasicOrderbook<Policy>::ActivateStops(TradeSink sink)
+{
+    if(activating_ || triggered_.empty()) {
+        return;
+    }
+
+    activating_ = true;
+    //by index and by copy: activating one stop can trigger more, which grows the queue under us
+    for(std::size_t next = 0; next < triggered_.size(); ++next) {
+        Order order = triggered_[next];
+        AddOrder(order, sink);
+    }
+    triggered_.clear();
+    activating_ = false;
+}
+
+template<typename Policy>
+void BasicOrderbook<Policy>::ScheduleExpiry(OrderHandle handle)
+{
+    if(pool_.Cold(handle).type_ == OrderType::GoodForDay && sessionEnd_ != NoExpiry) {
+        expiries_.Add(pool_, handle, sessionEnd_);
+    }
+}
+
+template<typename Policy>
+void BasicOrderbook<Policy>::LinkOrder(OrderHandle handle)
+{
+    const Price price = pool_.Cold(handle).price_;
+    const Quantity remaining = pool_.Hot(handle).remaining_;
+    if(pool_.Cold(handle).side_ == Side::Buy) {
+        auto& level = bids_[price];
+        ORDERBOOK_METRIC(if(level.Empty()) { metrics_.levelsCreated_.Add(); })
+        marketData_.Touch(Side::Buy, price, level);
+        level.PushBack(pool_, handle);
+        bids_.OnQuantityChanged(price, remaining);
+    }
+    else{
+        auto& level = asks_[price];
+        ORDERBOOK_METRIC(if(level.Empty()) { metrics_.levelsCreated_.Add(); })
+        marketData_.Touch(Side::Sell, price, level);
+        level.PushBack(pool_, handle);
+        asks_.OnQuantityChanged(price, remaining);
+    }
+}
+
+template<typename Policy>
+void BasicOrderbook<Policy>::UnlinkOrder(OrderHandle handle)
+{
+    const auto& order = pool_.Hot(handle);
+    auto price = pool_.Cold(handle).price_;
+    if(pool_.Cold(handle).side_ == Side::Sell) {
+        auto& orders = asks_.At(price);
+        marketData_.Touch(Side::Sell, price, orders);
+        asks_.OnQuantityChanged(price, -std::int64_t{order.remaining_});
+        orders.Erase(pool_, handle);
+        if(orders.Empty()) {
+            asks_.Erase(price);
+            ORDERBOOK_METRIC(metrics_.levelsDestroyed_.Add();)
+        }
+    }
+    else{
+        auto &orders = bids_.At(price);
+        marketData_.Touch(Side::Buy, price, orders);
+        bids_.OnQuantityChanged(price, -std::int64_t{order.remaining_});
+        orders.Erase(pool_, handle);
+        if (orders.Empty())
+        {
+            bids_.Erase(price);
+            ORDERBOOK_METRIC(metrics_.levelsDestroyed_.Add();)
+        }
+    }
+}
+
+template<typename Policy>
+std::size_t BasicOrderbook<Policy>::ExpireOrders(Timestamp now)
+{
+    CommandScope scope{*this};
+    std::size_t expired = 0;
+    while(expiries_.Due(now)) {
+        CancelOrder(pool_.Hot(expiries_.NextDue()).orderId_);
+        ++expired;
+    }
+    return expired;
+}
+
+template<typename Policy>
+std::size_t BasicOrderbook<Policy>::MatchBestLevels(Price bidTradePrice, Price askTradePrice, TradeSink sink, std::optional<Side> aggressor)
+{
+    Price bidPrice = bids_.BestPrice();
+    Price askPrice = asks_.BestPrice();
+    auto& bids = bids_.Best();
+    auto& asks = asks_.Best();
+    marketData_.Touch(Side::Buy, bidPrice, bids);
+    marketData_.Touch(Side::Sell, askPrice, asks);
+    Quantity matched = 0;
+    std::size_t fills = 0;
+
+    while(!bids.Empty() && !asks.Empty()) {
+        auto& bid = pool_.Hot(bids.Front());
+        auto& ask = pool_.Hot(asks.Front());
+        //owner_ shares a line with remaining_, so the common case costs one compare and a never-taken branch
+        if(bid.owner_ == ask.owner_ && bid.owner_ != Constants::NoOwner) [[unlikely]] {
+            ResolveSelfMatch(bids, bidPrice, asks, askPrice, aggressor, matched);
+            continue;
+        }
+        Quantity quantity = std::min(bid.remaining_, ask.remaining_);
+        bid.remaining_ -= quantity;
+        ask.remaining_ -= quantity;
+        bids.OnFill(quantity);
+        asks.OnFill(quantity);
+        matched += quantity;
+        ++fills;
+
+        sink(Trade{TradeInfo{bid.orderId_, bidTradePrice, quantity}, TradeInfo{ask.orderId_, askTradePrice, quantity}});
+
+        //an iceberg whose peak just filled goes round to the back of the level with its next peak
+        if(bid.remaining_ == 0) 
+        {
+            OrderHandle handle = bids.PopFront(pool_);
+            if(icebergs_ == 0 || !Replenish(bids, handle)) {
+                ReleaseOrder(handle);
             }
-            if(ask->IsFilled()) 
-            {
-                asks.pop_front();
-                orders_.erase(ask->GetOrderId());
+        }
+        if(ask.remaining_ == 0) 
+        {
+            OrderHandle handle = asks.PopFront(pool_);
+            if(icebergs_ == 0 || !Replenish(asks, handle)) {
+                ReleaseOrder(handle);
             }
+        }
+    }
+
+    bids_.OnQuantityChanged(bidPrice, -std::int64_t{matched});
+    asks_.OnQuantityChanged(askPrice, -std::int64_t{matched});
+
+    //erase after the inner loop so we never touch a level that no longer exists
+    if(bids.Empty()){
+        bids_.Erase(bidPrice);
+        ORDERBOOK_METRIC(metrics_.levelsDestroyed_.Add();)
+    }
+    if(asks.Empty()){
+        asks_.Erase(askPrice);
+        ORDERBOOK_METRIC(metrics_.levelsDestroyed_.Add();)
+    }
+    return fills;
+}
+
+template<typename Policy>
+template<typename Ladder>
+void BasicOrderbook<Policy>::SweepMarketOrder(Ladder& ladder, Side restingSide, const Order& order, TradeSink sink)
+{
+    ORDERBOOK_METRIC(std::uint64_t start = ReadCycles(); std::size_t levels = 0, fills = 0;)
+    const OrderId orderId = order.GetOrderId();
+    const OwnerId owner = order.GetOwnerId();
+    Quantity remaining = order.GetRemainingQuantity();
+
+    while(remaining > 0 && !ladder.Empty()) {
+        Price price = ladder.BestPrice();
+        auto& level = ladder.Best();
+        marketData_.Touch(restingSide, price, level);
+        //everything that leaves the level, filled or cancelled, comes off the ladder's totals once at the end
+        Quantity taken = 0;
+        bool printed = false;
+
+        while(remaining > 0 && !level.Empty()) {
+            auto& resting = pool_.Hot(level.Front());
+            bool selfMatch = resting.owner_ == owner && owner != Constants::NoOwner;
+            if(selfMatch) [[unlikely]] {
+                ORDERBOOK_METRIC(metrics_.selfMatches_.Add();)
+                if(selfMatchPolicy_ == SelfMatchPolicy::CancelAggressor) {
+                    remaining = 0;
+                    break;
+                }
+                if(selfMatchPolicy_ == SelfMatchPolicy::CancelResting) {
+                    taken += resting.remaining_;
+                    ReleaseOrder(level.PopFront(pool_));
+                    continue;
+                }
+                //DecrementBoth: the fill below, minus the print
+            }
+
+            Quantity quantity = std::min(remaining, resting.remaining_);
+            resting.remaining_ -= quantity;
+            remaining -= quantity;
+            level.OnFill(quantity);
+            taken += quantity;
+            if(!selfMatch) [[likely]] {
+                TradeInfo aggressor{orderId, price, quantity};
+                TradeInfo passive{resting.orderId_, price, quantity};
+                sink(restingSide == Side::Sell ? Trade{aggressor, passive} : Trade{passive, aggressor});
+                printed = true;
+                ORDERBOOK_METRIC(++fills;)
+            }
+            if(resting.remaining_ == 0) {
+                OrderHandle handle = level.PopFront(pool_);
+                if(icebergs_ == 0 || !Replenish(level, handle)) {
+                    ReleaseOrder(handle);
+                }
+            }
+        }
+
+        ladder.OnQuantityChanged(price, -std::int64_t{taken});
+        if(level.Empty()) {
+            ladder.Erase(price);
+            ORDERBOOK_METRIC(metrics_.levelsDestroyed_.Add();)
+        }
+        if(printed) {
+            TriggerStops(price, price);
+        }
+        ORDERBOOK_METRIC(++levels;)
+    }
+
+    ORDERBOOK_METRIC(
+        if(fills) {
+            metrics_.match_.Record(ReadCycles() - start);
+            metrics_.fillsPerAggressor_.Record(fills);
+            metrics_.maxSweepDepth_.RaiseTo(levels);
+        }
+    )
+}
+
+template<typename Policy>
+void BasicOrderbook<Policy>::ResolveSelfMatch(PriceLevel& bids, Price bidPrice, PriceLevel& asks, Price askPrice,
+    std::optional<Side> aggressor, Quantity& matched)
+{
+    ORDERBOOK_METRIC(metrics_.selfMatches_.Add();)
+    auto& bid = pool_.Hot(bids.Front());
+    auto& ask = pool_.Hot(asks.Front());
+    SelfMatchPolicy policy = aggressor ? selfMatchPolicy_ : SelfMatchPolicy::DecrementBoth;
 
-            if(bids.empty()){
-                bids_.erase(bidPrice);
+    //a fill that doesn't print: the caller takes `matched` off both ladders as usual
+    if(policy == SelfMatchPolicy::DecrementBoth) {
+        Quantity quantity = std::min(bid.remaining_, ask.remaining_);
+        bid.remaining_ -= quantity;
+        ask.remaining_ -= quantity;
+        bids.OnFill(quantity);
+        asks.OnFill(quantity);
+        matched += quantity;
+        if(bid.remaining_ == 0) {
+            OrderHandle handle = bids.PopFront(pool_);
+            if(icebergs_ == 0 || !Replenish(bids, handle)) {
+                ReleaseOrder(handle);
             }
-            if(asks.empty()){
-                asks_.erase(askPrice);
+        }
+        if(ask.remaining_ == 0) {
+            OrderHandle handle = asks.PopFront(pool_);
+            if(icebergs_ == 0 || !Replenish(asks, handle)) {
+                ReleaseOrder(handle);
             }
+        }
+        return;
+    }
 
-            trades.push_back(Trade{TradeInfo{bid->GetOrderId(), bid->GetPrice(), quantity}, TradeInfo{ask->GetOrderId(), ask->GetPrice(), quantity}});
+    //the book was uncrossed before the aggressor arrived, so it is the front of its own side's best level
+    bool cancelBid = (policy == SelfMatchPolicy::CancelAggressor) == (*aggressor == Side::Buy);
+    if(cancelBid) {
+        bids_.OnQuantityChanged(bidPrice, -std::int64_t{bid.remaining_});
+        ReleaseOrder(bids.PopFront(pool_));
+    }
+    else {
+        asks_.OnQuantityChanged(askPrice, -std::int64_t{ask.remaining_});
+        ReleaseOrder(asks.PopFront(pool_));
+    }
+}
+
+template<typename Policy>
+void BasicOrderbook<Policy>::MatchOrders(TradeSink sink, std::optional<Side> aggressor)
+{
+    ORDERBOOK_METRIC(std::uint64_t start = ReadCycles(); std::size_t levels = 0, fills = 0;)
+    while(!bids_.Empty() && !asks_.Empty()){
+        Price bidPrice = bids_.BestPrice();
+        Price askPrice = asks_.BestPrice();
+
+        if(bidPrice < askPrice) {
+            break;
+        }
+
+        //continuous trading: each side trades at its own limit
+        std::size_t levelFills = MatchBestLevels(bidPrice, askPrice, sink, aggressor);
+        ORDERBOOK_METRIC(++levels; fills += levelFills;)
+        //the print is the resting side's price; with no single aggressor each side's stops see the other side's price
+        if(levelFills != 0) {
+            TriggerStops(aggressor == Side::Sell ? bidPrice : askPrice, aggressor == Side::Buy ? askPrice : bidPrice);
         }
     }
 
-    if(!bids_.empty()) {
-        auto& [_, bids] = *bids_.begin();
-        auto& order = bids.front();
-        if(order->GetOrderType() == OrderType::FillAndKill){
-            CancelOrder(order->GetOrderId());
+    ORDERBOOK_METRIC(
+        if(levels) {
+            metrics_.match_.Record(ReadCycles() - start);
+            metrics_.fillsPerAggressor_.Record(fills);
+            metrics_.maxSweepDepth_.RaiseTo(levels);
+        }
+    )
+
+    if(!bids_.Empty()) {
+        OrderHandle front = bids_.Best().Front();
+        OrderType type = pool_.Cold(front).type_;
+        if(type == OrderType::FillAndKill || type == OrderType::FillOrKill){
+            CancelOrder(pool_.Hot(front).orderId_);
         }
     }
 
-    if(!asks_.empty()) {
-        auto [_, asks] = *asks_.begin();
-        auto& order = asks.front();
-        if(order->GetOrderType() == OrderType::FillAndKill) {
-            CancelOrder(order->GetOrderId());
+    if(!asks_.Empty()) {
+        OrderHandle front = asks_.Best().Front();
+        OrderType type = pool_.Cold(front).type_;
+        if(type == OrderType::FillAndKill || type == OrderType::FillOrKill) {
+            CancelOrder(pool_.Hot(front).orderId_);
         }
     }
+}
 
-    return trades;
+
+template<typename Policy>
+Trades BasicOrderbook<Policy>::AddOrder(OrderPointer order)
+{
+    return AddOrder(*order);
 }
 
+template<typename Policy>
+Trades BasicOrderbook<Policy>::AddOrder(const Order& order)
+{
+    Trades trades;
+    auto collect = [&trades](const Trade& trade) { trades.push_back(trade); };
+    AddOrder(order, TradeSink{collect});
+    return trades;
+}
 
-Trades Orderbook::AddOrder(OrderPointer order)
+template<typename Policy>
+void BasicOrderbook<Policy>::AddOrder(const Order& order, TradeSink sink)
 {
+    CommandScope scope{*this};
+    ORDERBOOK_METRIC(ScopedCycles timer{metrics_.add_, marketData_.Outermost()};)
+    if(phase_ == TradingPhase::Closed) {
+        return;
+    }
+
     //contains
-    if(orders_.find(order->GetOrderId()) != orders_.end()){
-        return {};
+    if(orders_.Contains(order.GetOrderId())){
+        return;
     }
 
-    if(order->GetOrderType() == OrderType::FillAndKill && !CanMatch(order->GetSide(), order->GetPrice())){
-        return {};
+    //a stop takes a pool slot and an id like any order, so it can be cancelled, but no level until it triggers
+    if(IsStop(order.GetOrderType())) {
+        OrderHandle handle = pool_.Allocate(order);
+        orders_.Insert(order.GetOrderId(), OrderEntry{handle});
+        LinkStop(handle);
+        return;
     }
 
-    OrderPointers::iterator iterator;
+    if(order.GetOrderType() == OrderType::Market) {
+        if(phase_ == TradingPhase::Continuous) {
+            if(order.GetSide() == Side::Buy) {
+                SweepMarketOrder(asks_, Side::Sell, order, sink);
+            }
+            else {
+                SweepMarketOrder(bids_, Side::Buy, order, sink);
+            }
+            ActivateStops(sink);
+        }
+        return;
+    }
 
-    if(order->GetSide() == Side::Buy) {
-        auto& orders = bids_[order->GetPrice()];
-        orders.push_back(order);
-        iterator = std::next(orders.begin(), orders.size() - 1);
+    //nothing matches during an auction, so an immediate-or-cancel order has nothing to do there
+    if(order.GetOrderType() == OrderType::FillAndKill && (phase_ == TradingPhase::Auction || !CanMatch(order.GetSide(), order.GetPrice()))){
+        return;
     }
-    else{
-        auto &orders = asks_[order->GetPrice()];
-        orders.push_back(order);
-        iterator = std::next(orders.begin(), orders.size() - 1);
+
+    if(order.GetOrderType() == OrderType::FillOrKill && (phase_ == TradingPhase::Auction || !CanFullyFill(order.GetSide(), order.GetPrice(), order.GetInitialQuantity(), order.GetOwnerId()))){
+        return;
     }
 
-    orders_.insert({order->GetOrderId(), OrderEntry{order, iterator}});
+    OrderHandle handle = pool_.Allocate(order);
+    LinkOrder(handle);
+    orders_.Insert(order.GetOrderId(), OrderEntry{handle});
+    ScheduleExpiry(handle);
+    if(order.GetOrderType() == OrderType::Iceberg) {
+        ++icebergs_;
+    }
 
-    return MatchOrders();
+    if(phase_ == TradingPhase::Continuous) {
+        MatchOrders(sink, order.GetSide());
+        ActivateStops(sink);
+    }
 }
 
-void Orderbook::CancelOrder(OrderId orderId) {
-    if(orders_.find(orderId) == orders_.end()) {
+template<typename Policy>
+Trades BasicOrderbook<Policy>::AddOrders(std::span<const OrderRequest> requests)
+{
+    Trades trades;
+    auto collect = [&trades](const Trade& trade) { trades.push_back(trade); };
+    AddOrders(requests, TradeSink{collect});
+    return trades;
+}
+
+template<typename Policy>
+void BasicOrderbook<Policy>::AddOrders(std::span<const OrderRequest> requests, TradeSink sink)
+{
+    CommandScope scope{*this};
+    if(phase_ == TradingPhase::Closed) {
         return;
     }
 
-    const auto& [order, orderIterator] = orders_.at(orderId);
-    orders_.erase(orderId);
+    //one pass rejects ids already in the book and repeats within the burst, since the first copy is already inserted
+    batch_.clear();
+    for(std::size_t i = 0; i < requests.size(); ++i) {
+        const auto& request = requests[i];
+        if(orders_.Contains(request.orderId_)) {
+            continue;
+        }
+        if(request.orderType_ == OrderType::FillAndKill && phase_ == TradingPhase::Auction) {
+            continue;
+        }
+        //all-or-nothing can't be judged while the rest of the burst is still landing, market orders never rest and
+        //stops never rest on a level; they all go in afterwards
+        if(request.orderType_ == OrderType::FillOrKill || request.orderType_ == OrderType::Market || IsStop(request.orderType_)) {
+            continue;
+        }
+        OrderHandle handle = pool_.Allocate(request.ToOrder());
+        orders_.Insert(request.orderId_, OrderEntry{handle});
+        ScheduleExpiry(handle);
+        if(request.orderType_ == OrderType::Iceberg) {
+            ++icebergs_;
+        }
+        batch_.push_back(BatchEntry{handle, static_cast<std::uint32_t>(i)});
+    }
+
+    //group by level, keeping arrival order inside a level so time priority is the span order
+    std::sort(batch_.begin(), batch_.end(), [&requests](const BatchEntry& lhs, const BatchEntry& rhs) {
+        const auto& l = requests[lhs.sequence_];
+        const auto& r = requests[rhs.sequence_];
+        return std::tuple{l.side_, l.price_, lhs.sequence_} < std::tuple{r.side_, r.price_, rhs.sequence_};
+    });
 
-    if(order->GetSide() == Side::Sell) {
-        auto price = order->GetPrice();
-        auto& orders = asks_.at(price);
-        orders.erase(orderIterator);
-        if(orders.empty()) {
-            asks_.erase(price);
+    PriceLevel* level = nullptr;
+    for(std::size_t i = 0; i < batch_.size(); ++i) {
+        const auto& order = requests[batch_[i].sequence_];
+        if(!level || order.side_ != requests[batch_[i - 1].sequence_].side_ || order.price_ != requests[batch_[i - 1].sequence_].price_) {
+            level = order.side_ == Side::Buy ? &bids_[order.price_] : &asks_[order.price_];
+            ORDERBOOK_METRIC(if(level->Empty()) { metrics_.levelsCreated_.Add(); })
+            marketData_.Touch(order.side_, order.price_, *level);
+        }
+        level->PushBack(pool_, batch_[i].handle_);
+        //what shows, which for an iceberg is less than the request's quantity
+        Quantity shown = pool_.Hot(batch_[i].handle_).remaining_;
+        if(order.side_ == Side::Buy) {
+            bids_.OnQuantityChanged(order.price_, shown);
+        }
+        else {
+            asks_.OnQuantityChanged(order.price_, shown);
         }
     }
-    else{
-        auto price = order->GetPrice();
-        auto &orders = bids_.at(price);
-        orders.erase(orderIterator);
-        if (orders.empty())
-        {
-            bids_.erase(price);
+
+    //an auction only collects orders; the deferred requests still go through AddOrder below, which rests the stops
+    //and drops what can't be entered until continuous trading
+    if(phase_ == TradingPhase::Continuous) {
+        MatchOrders(sink);
+
+        for(const auto& entry : batch_) {
+            const auto& request = requests[entry.sequence_];
+            if(request.orderType_ == OrderType::FillAndKill) {
+                CancelOrder(request.orderId_);
+            }
+        }
+        ActivateStops(sink);
+    }
+
+    for(const auto& request : requests) {
+        if(request.orderType_ == OrderType::FillOrKill || request.orderType_ == OrderType::Market || IsStop(request.orderType_)) {
+            AddOrder(request.ToOrder(), sink);
+        }
+    }
+}
+
+template<typename Policy>
+void BasicOrderbook<Policy>::CancelOrders(std::span<const OrderId> orderIds)
+{
+    CommandScope scope{*this};
+    for(OrderId orderId : orderIds) {
+        CancelOrder(orderId);
+    }
+}
+
+template<typename Policy>
+void BasicOrderbook<Policy>::CancelOrder(OrderId orderId) {
+    CommandScope scope{*this};
+    ORDERBOOK_METRIC(ScopedCycles timer{metrics_.cancel_, marketData_.Outermost()};)
+    const auto* entry = orders_.Find(orderId);
+    if(!entry) {
+        return;
+    }
+
+    const OrderHandle handle = entry->location_;
+    if(IsStop(pool_.Cold(handle).type_)) {
+        UnlinkStop(handle);
+    }
+    else {
+        UnlinkOrder(handle);
+    }
+    ReleaseOrder(handle);
+}
+
+template<typename Policy>
+Trades BasicOrderbook<Policy>::ModifyOrder(OrderModify order) {
+    Trades trades;
+    auto collect = [&trades](const Trade& trade) { trades.push_back(trade); };
+    ModifyOrder(order, TradeSink{collect});
+    return trades;
+}
+
+template<typename Policy>
+void BasicOrderbook<Policy>::ModifyOrder(OrderModify order, TradeSink sink) {
+    CommandScope scope{*this};
+    ORDERBOOK_METRIC(ScopedCycles timer{metrics_.modify_, marketData_.Outermost()};)
+    if(phase_ == TradingPhase::Closed) {
+        return;
+    }
+    const auto* entry = orders_.Find(order.GetOrderId());
+    if(!entry){
+        return;
+    }
+    if(order.GetQuantity() == 0) {
+        CancelOrder(order.GetOrderId());
+        return;
+    }
+
+    //the modify's quantity is the new open quantity; whatever already traded stays traded
+    const OrderHandle handle = entry->location_;
+    auto& hot = pool_.Hot(handle);
+    auto& cold = pool_.Cold(handle);
+    if(IsStop(cold.type_)) {
+        return;
+    }
+
+    //an iceberg's open quantity includes its hidden reserve
+    const Quantity open = hot.remaining_ + cold.reserve_;
+
+    //reduce-only: the order keeps its place in the queue, nothing is allocated or re-indexed
+    if(order.GetSide() == cold.side_ && order.GetPrice() == cold.price_ && order.GetQuantity() <= open) {
+        Quantity reduction = open - order.GetQuantity();
+        if(reduction == 0) {
+            return;
+        }
+        //an iceberg gives up hidden quantity first, so what shows only shrinks once the reserve is gone
+        Quantity hidden = std::min(reduction, cold.reserve_);
+        Quantity shown = reduction - hidden;
+        cold.reserve_ -= hidden;
+        cold.initial_ -= reduction;
+        if(shown == 0) {
+            return;
+        }
+        if(cold.side_ == Side::Buy) {
+            auto& level = bids_.At(cold.price_);
+            marketData_.Touch(Side::Buy, cold.price_, level);
+            level.OnFill(shown);
+            bids_.OnQuantityChanged(cold.price_, -std::int64_t{shown});
+        }
+        else {
+            auto& level = asks_.At(cold.price_);
+            marketData_.Touch(Side::Sell, cold.price_, level);
+            level.OnFill(shown);
+            asks_.OnQuantityChanged(cold.price_, -std::int64_t{shown});
+        }
+        hot.remaining_ -= shown;
+        return;
+    }
+
+    //a new price, side or a bigger quantity goes to the back of its (new) level: the same node is moved there,
+    //so the pool slot, the id index entry and the expiry registration all stay as they are
+    //an iceberg comes back showing a fresh peak
+    UnlinkOrder(handle);
+    Quantity filled = cold.initial_ - open;
+    cold.price_ = order.GetPrice();
+    hot.remaining_ = cold.type_ == OrderType::Iceberg ? std::min(cold.peak_, order.GetQuantity()) : order.GetQuantity();
+    cold.reserve_ = order.GetQuantity() - hot.remaining_;
+    cold.side_ = order.GetSide();
+    cold.initial_ = filled + order.GetQuantity();
+    LinkOrder(handle);
+
+    if(phase_ == TradingPhase::Continuous) {
+        MatchOrders(sink, order.GetSide());
+        ActivateStops(sink);
+    }
+}
+
+template<typename Policy>
+void BasicOrderbook<Policy>::Apply(const OrderCommand& command, TradeSink sink) {
+    switch(command.type_) {
+        case CommandType::Add:
+            AddOrder(Order{command.orderType_, command.orderId_, command.side_, command.price_, command.quantity_, command.ownerId_,
+                command.peakQuantity_, command.stopPrice_}, sink);
+            break;
+        case CommandType::Cancel:
+            CancelOrder(command.orderId_);
+            break;
+        case CommandType::Modify:
+            ModifyOrder(OrderModify{command.orderId_, command.side_, command.price_, command.quantity_}, sink);
+            break;
+        case CommandType::OpenAuction:
+            OpenAuction();
+            break;
+        case CommandType::CloseBook:
+            CloseBook();
+            break;
+        case CommandType::Uncross:
+            Uncross(sink, static_cast<TradingPhase>(command.orderId_));
+            break;
+        case CommandType::SetSessionEnd:
+            SetSessionEnd(static_cast<Timestamp>(command.orderId_));
+            break;
+        case CommandType::SetSelfMatchPolicy:
+            SetSelfMatchPolicy(static_cast<SelfMatchPolicy>(command.orderId_));
+            break;
+        case CommandType::SetReferencePrice:
+            SetReferencePrice(static_cast<Price>(static_cast<std::int64_t>(command.orderId_)));
+            break;
+    }
+}
+
+template<typename Policy>
+void BasicOrderbook<Policy>::OpenAuction()
+{
+    Guard guard{mutex_};
+    phase_ = TradingPhase::Auction;
+}
+
+template<typename Policy>
+void BasicOrderbook<Policy>::CloseBook()
+{
+    Guard guard{mutex_};
+    phase_ = TradingPhase::Closed;
+}
+
+template<typename Policy>
+AuctionResult BasicOrderbook<Policy>::GetIndicativeUncross() const
+{
+    Guard guard{mutex_};
+    AuctionResult result{0, 0, 0};
+    if(bids_.Empty() || asks_.Empty() || bids_.BestPrice() < asks_.BestPrice()) {
+        return result;
+    }
+
+    //only levels inside [best ask, best bid] can trade, so that's all we look at; icebergs' reserves trade in the
+    //uncross too, as each peak fills and the next one shows
+    const Price bestBid = bids_.BestPrice();
+    const Price bestAsk = asks_.BestPrice();
+    std::int64_t totalAsk = 0;
+    crossedBids_.clear();
+    crossedAsks_.clear();
+    bids_.ForEach([&](Price price, const PriceLevel& level) {
+        if(price < bestAsk) {
+            return false;
+        }
+        crossedBids_.push_back(LevelInfo{price, level.quantity_ + (icebergs_ != 0 ? HiddenQuantity(level) : 0), level.count_});
+        return true;
+    });
+    asks_.ForEach([&](Price price, const PriceLevel& level) {
+        if(price > bestBid) {
+            return false;
+        }
+        crossedAsks_.push_back(LevelInfo{price, level.quantity_ + (icebergs_ != 0 ? HiddenQuantity(level) : 0), level.count_});
+        totalAsk += crossedAsks_.back().quantity_;
+        return true;
+    });
+
+    //walk every candidate price from the top down:
+    //demand = bids at or above the price (grows as we go down), supply = asks at or below it (shrinks)
+    std::int64_t demand = 0, supply = totalAsk;
+    std::size_t bid = 0;
+    std::ptrdiff_t ask = static_cast<std::ptrdiff_t>(crossedAsks_.size()) - 1;
+    std::int64_t bestImbalance = 0;
+    while(bid < crossedBids_.size() || ask >= 0) {
+        Price price = bid < crossedBids_.size() ? crossedBids_[bid].price_ : crossedAsks_[ask].price_;
+        if(ask >= 0 && crossedAsks_[ask].price_ > price) {
+            price = crossedAsks_[ask].price_;
+        }
+
+        while(bid < crossedBids_.size() && crossedBids_[bid].price_ == price) {
+            demand += crossedBids_[bid++].quantity_;
+        }
+
+        //most volume wins, then the smallest imbalance, then the price nearer the reference price, then the lower price
+        std::int64_t volume = std::min(demand, supply);
+        std::int64_t imbalance = demand - supply;
+        bool better = volume > result.volume_;
+        if(!better && volume == result.volume_ && volume > 0) {
+            if(std::abs(imbalance) != std::abs(bestImbalance)) {
+                better = std::abs(imbalance) < std::abs(bestImbalance);
+            }
+            else {
+                better = !referencePrice_ || std::abs(price - *referencePrice_) <= std::abs(result.price_ - *referencePrice_);
+            }
+        }
+        if(better) {
+            result = AuctionResult{price, static_cast<Quantity>(volume), imbalance};
+            bestImbalance = imbalance;
+        }
+
+        while(ask >= 0 && crossedAsks_[ask].price_ == price) {
+            supply -= crossedAsks_[ask--].quantity_;
         }
     }
+
+    return result;
 }
 
-Trades Orderbook::ModifyOrder(OrderModify order) {
-    if(orders_.find(order.GetOrderId()) == orders_.end()){
-        return { };
+template<typename Policy>
+AuctionResult BasicOrderbook<Policy>::Uncross(TradeSink sink, TradingPhase next)
+{
+    CommandScope scope{*this};
+    if(phase_ != TradingPhase::Auction) {
+        return AuctionResult{0, 0, 0};
+    }
+    AuctionResult result = GetIndicativeUncross();
+
+    //everything at or through the equilibrium price trades at that price, in price-time priority
+    if(result.volume_ > 0) {
+        while(!bids_.Empty() && !asks_.Empty() && bids_.BestPrice() >= result.price_ && asks_.BestPrice() <= result.price_) {
+            MatchBestLevels(result.price_, result.price_, sink, std::nullopt);
+        }
+        //a triggered stop can only be entered into continuous trading; otherwise the stops stay pending for a later print
+        if(next == TradingPhase::Continuous) {
+            TriggerStops(result.price_, result.price_);
+        }
     }
-    const auto& [existingOrder, _] = orders_.at(order.GetOrderId());
-    CancelOrder(order.GetOrderId());
-    return AddOrder(order.ToOrderPointer(existingOrder->GetOrderType()));
+
+    phase_ = next;
+    if(phase_ == TradingPhase::Continuous) {
+        MatchOrders(sink);
+    }
+    ActivateStops(sink);
+    return result;
 }
 
-std::size_t Orderbook::Size() const {return orders_.size();}
+template<typename Policy>
+void BasicOrderbook<Policy>::RestoreOrder(const Order& order, Timestamp expiry)
+{
+    CommandScope scope{*this};
+    if(orders_.Contains(order.GetOrderId())) {
+        return;
+    }
 
-OrderbookLevelInfos Orderbook::GetOrderInfos() const 
+    OrderHandle handle = pool_.Allocate(order);
+    if(IsStop(order.GetOrderType())) {
+        LinkStop(handle);
+    }
+    else {
+        LinkOrder(handle);
+    }
+    orders_.Insert(order.GetOrderId(), OrderEntry{handle});
+    if(expiry != NoExpiry) {
+        expiries_.Add(pool_, handle, expiry);
+    }
+    if(order.GetOrderType() == OrderType::Iceberg) {
+        ++icebergs_;
+    }
+}
+
+template<typename Policy>
+void BasicOrderbook<Policy>::SetMarketDataSink(MarketDataSink sink, std::uint64_t snapshotInterval, std::size_t capacity)
 {
-    LevelInfos bidInfos, askInfos;
-    bidInfos.reserve(orders_.size());
-    askInfos.reserve(orders_.size());
-
-    //lambda function that creates a "level" for each price
-    auto CreateLevelInfos = [](Price price, const OrderPointers& orders)
-    {
-        return LevelInfo{price, std::accumulate(orders.begin(), orders.end(), (Quantity)0, 
-        [](Quantity runningSum, const OrderPointer& order)
-            {return runningSum + order->GetRemainingQuantity(); } ) };
-    };
+    Guard guard{mutex_};
+    marketData_.Attach(sink, snapshotInterval, capacity);
+    marketData_.PublishSnapshot(bids_, asks_);
+}
 
-    for(const auto& [price, orders] : bids_) {
-        bidInfos.push_back(CreateLevelInfos(price, orders));
+template<typename Policy>
+void BasicOrderbook<Policy>::PublishTopOfBook()
+{
+    TopOfBook top{};
+    if(!bids_.Empty()) {
+        const auto& level = bids_.Best();
+        top.bidPrice_ = bids_.BestPrice();
+        top.bidQuantity_ = level.quantity_;
+        top.bidCount_ = level.count_;
     }
-    for(const auto& [price, orders] : asks_) {
-        askInfos.push_back(CreateLevelInfos(price, orders));
+    if(!asks_.Empty()) {
+        const auto& level = asks_.Best();
+        top.askPrice_ = asks_.BestPrice();
+        top.askQuantity_ = level.quantity_;
+        top.askCount_ = level.count_;
+    }
+    //most commands land behind the touch; those leave the cell alone
+    if(top.SameLevels(top_)) {
+        return;
     }
+    top.sequence_ = top_.sequence_ + 1;
+    top_ = top;
+    topCell_.Publish(top);
+}
+
+template<typename Policy>
+void BasicOrderbook<Policy>::PublishMarketDataSnapshot()
+{
+    Guard guard{mutex_};
+    marketData_.PublishSnapshot(bids_, asks_);
+}
+
+template<typename Policy>
+std::size_t BasicOrderbook<Policy>::Size() const
+{
+    Guard guard{mutex_};
+    return orders_.Size();
+}
+
+template<typename Policy>
+OrderIdMapStats BasicOrderbook<Policy>::GetOrderIdStats() const
+{
+    Guard guard{mutex_};
+    return orders_.Stats();
+}
+
+template<typename Policy>
+OrderbookLevelInfos BasicOrderbook<Policy>::GetOrderInfos() const 
+{
+    Guard guard{mutex_};
+    LevelInfos bidInfos, askInfos;
+    bidInfos.reserve(bids_.LevelCount());
+    askInfos.reserve(asks_.LevelCount());
+
+    bids_.ForEach([&](Price price, const PriceLevel& level) {
+        bidInfos.push_back(LevelInfo{price, level.quantity_, level.count_});
+    });
+    asks_.ForEach([&](Price price, const PriceLevel& level) {
+        askInfos.push_back(LevelInfo{price, level.quantity_, level.count_});
+    });
 
     return OrderbookLevelInfos{bidInfos, askInfos};
 }
 
+template<typename Policy>
+LevelInfoCounts BasicOrderbook<Policy>::GetOrderInfos(std::span<LevelInfo> bids, std::span<LevelInfo> asks) const
+{
+    Guard guard{mutex_};
+    LevelInfoCounts counts{0, 0};
+
+    bids_.ForEach([&](Price price, const PriceLevel& level) {
+        bids[counts.bids_++] = LevelInfo{price, level.quantity_, level.count_};
+    }, bids.size());
+    asks_.ForEach([&](Price price, const PriceLevel& level) {
+        asks[counts.asks_++] = LevelInfo{price, level.quantity_, level.count_};
+    }, asks.size());
+
+    return counts;
+}
 
+template class BasicOrderbook<DefaultOrderbookPolicy>;
+template class BasicOrderbook<LockedOrderbookPolicy>;
+template class BasicOrderbook<StdIndexOrderbookPolicy>;
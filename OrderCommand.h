@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+
+#include "OrderType.h"
+#include "Side.h"
+#include "Usings.h"
+#include "Constants.h"
+
+enum class CommandType : std::uint8_t
+{
+    Add,
+    Cancel,
+    Modify,
+    // session commands: phase and policy changes travel through the same rings and journal as orders, so a replay
+    // goes through the same phases at the same points
+    OpenAuction,
+    CloseBook,
+    Uncross,
+    SetSessionEnd,
+    SetSelfMatchPolicy,
+    SetReferencePrice,
+};
+
+// a request to the book in plain-old-data form, so it can be copied through rings and files as-is
+// Cancel only uses orderId_; Modify ignores orderType_, ownerId_, peakQuantity_ and stopPrice_ (the resting order keeps its own)
+// session commands carry their one argument (Uncross's next phase, the session end, the policy or the price) in orderId_
+struct OrderCommand
+{
+    CommandType type_;
+    OrderType orderType_;
+    Side side_;
+    OrderId orderId_;
+    Price price_;
+    Quantity quantity_;
+    OwnerId ownerId_{Constants::NoOwner};
+    // Iceberg only, as in Order
+    Quantity peakQuantity_{0};
+    // Stop and StopLimit only, as in Order
+    Price stopPrice_{Constants::InvalidPrice};
+
+    static OrderCommand Session(CommandType type, std::int64_t argument = 0)
+    {
+        return OrderCommand{type, OrderType::GoodTillCancel, Side::Buy, static_cast<OrderId>(argument), 0, 0};
+    }
+};
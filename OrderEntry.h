@@ -0,0 +1,259 @@
+#pragma once
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+
+#include "OrderCommand.h"
+
+static_assert(std::endian::native == std::endian::little, "order entry messages are little-endian on the wire");
+
+// binary order entry, loosely after OUCH: fixed-width little-endian messages, every one starting with its length and
+// type, and every field at its natural alignment so a message is a handful of loads rather than a parse
+// client -> book: EnterOrder 'O', CancelOrder 'X', ReplaceOrder 'U'
+// book -> client: Executed 'E' for every trade, then Accepted 'A' once a command has been fully handled
+struct WireHeader
+{
+    std::uint16_t length_;
+    char type_;
+    std::uint8_t reserved_;
+};
+
+struct EnterOrderMessage
+{
+    static constexpr char Type = 'O';
+
+    WireHeader header_;
+    Quantity quantity_;
+    OrderId orderId_;
+    Price price_;
+    OwnerId ownerId_;
+    std::uint8_t side_;
+    std::uint8_t orderType_;
+    std::uint8_t reserved_[2];
+    // Iceberg only: the most that shows at once
+    Quantity peakQuantity_;
+    // Stop and StopLimit only
+    Price stopPrice_;
+    std::uint32_t reserved2_;
+
+    static EnterOrderMessage FromCommand(const OrderCommand &command)
+    {
+        return EnterOrderMessage{
+            WireHeader{sizeof(EnterOrderMessage), Type, 0},
+            command.quantity_,
+            command.orderId_,
+            command.price_,
+            command.ownerId_,
+            static_cast<std::uint8_t>(command.side_),
+            static_cast<std::uint8_t>(command.orderType_),
+            {},
+            command.peakQuantity_,
+            command.stopPrice_,
+            0,
+        };
+    }
+
+    OrderCommand ToCommand() const
+    {
+        return OrderCommand{CommandType::Add, static_cast<OrderType>(orderType_), static_cast<Side>(side_), orderId_, price_, quantity_, ownerId_, peakQuantity_, stopPrice_};
+    }
+};
+
+struct CancelOrderMessage
+{
+    static constexpr char Type = 'X';
+
+    WireHeader header_;
+    std::uint32_t reserved_;
+    OrderId orderId_;
+
+    static CancelOrderMessage FromCommand(const OrderCommand &command)
+    {
+        return CancelOrderMessage{WireHeader{sizeof(CancelOrderMessage), Type, 0}, 0, command.orderId_};
+    }
+
+    OrderCommand ToCommand() const
+    {
+        return OrderCommand{CommandType::Cancel, OrderType::GoodTillCancel, Side::Buy, orderId_, 0, 0};
+    }
+};
+
+// same semantics as ModifyOrder: the quantity is the new open quantity and the order keeps its type and owner
+struct ReplaceOrderMessage
+{
+    static constexpr char Type = 'U';
+
+    WireHeader header_;
+    Quantity quantity_;
+    OrderId orderId_;
+    Price price_;
+    std::uint8_t side_;
+    std::uint8_t reserved_[3];
+
+    static ReplaceOrderMessage FromCommand(const OrderCommand &command)
+    {
+        return ReplaceOrderMessage{
+            WireHeader{sizeof(ReplaceOrderMessage), Type, 0},
+            command.quantity_,
+            command.orderId_,
+            command.price_,
+            static_cast<std::uint8_t>(command.side_),
+            {},
+        };
+    }
+
+    OrderCommand ToCommand() const
+    {
+        return OrderCommand{CommandType::Modify, OrderType::GoodTillCancel, static_cast<Side>(side_), orderId_, price_, quantity_};
+    }
+};
+
+// one per trade, carrying both sides so either owner can pick out its fill
+struct ExecutedMessage
+{
+    static constexpr char Type = 'E';
+
+    WireHeader header_;
+    Quantity quantity_;
+    OrderId bidOrderId_;
+    OrderId askOrderId_;
+    Price bidPrice_;
+    Price askPrice_;
+};
+
+// the command with this order id has been applied and every trade it caused has been sent ahead of this
+struct AcceptedMessage
+{
+    static constexpr char Type = 'A';
+
+    WireHeader header_;
+    std::uint32_t reserved_;
+    OrderId orderId_;
+};
+
+static_assert(sizeof(WireHeader) == 4);
+static_assert(sizeof(EnterOrderMessage) == 40 && std::is_trivially_copyable_v<EnterOrderMessage>);
+static_assert(sizeof(CancelOrderMessage) == 16 && std::is_trivially_copyable_v<CancelOrderMessage>);
+static_assert(sizeof(ReplaceOrderMessage) == 24 && std::is_trivially_copyable_v<ReplaceOrderMessage>);
+static_assert(sizeof(ExecutedMessage) == 32 && std::is_trivially_copyable_v<ExecutedMessage>);
+static_assert(sizeof(AcceptedMessage) == 16 && std::is_trivially_copyable_v<AcceptedMessage>);
+
+// the wire form of a command, for senders; returns 0 (writes nothing) for a session command
+inline std::size_t EncodeCommand(const OrderCommand &command, std::byte *out)
+{
+    switch (command.type_)
+    {
+    case CommandType::Add:
+    {
+        auto message = EnterOrderMessage::FromCommand(command);
+        std::memcpy(out, &message, sizeof(message));
+        return sizeof(message);
+    }
+    case CommandType::Cancel:
+    {
+        auto message = CancelOrderMessage::FromCommand(command);
+        std::memcpy(out, &message, sizeof(message));
+        return sizeof(message);
+    }
+    case CommandType::Modify:
+    {
+        auto message = ReplaceOrderMessage::FromCommand(command);
+        std::memcpy(out, &message, sizeof(message));
+        return sizeof(message);
+    }
+    // session commands come from the operator, not from clients, so they have no wire form
+    case CommandType::OpenAuction:
+    case CommandType::CloseBook:
+    case CommandType::Uncross:
+    case CommandType::SetSessionEnd:
+    case CommandType::SetSelfMatchPolicy:
+    case CommandType::SetReferencePrice:
+        break;
+    }
+    return 0;
+}
+
+// largest message EncodeCommand writes
+constexpr std::size_t MaxCommandMessageSize = sizeof(EnterOrderMessage);
+
+// a receive buffer has no alignment guarantee, so fields come out through memcpy, which compiles to plain loads
+template<typename Message>
+Message LoadWireMessage(const std::byte *data)
+{
+    Message message;
+    std::memcpy(&message, data, sizeof(message));
+    return message;
+}
+
+// length a client message of `type` must have, or 0 for a type clients don't send
+constexpr std::size_t ClientMessageLength(char type)
+{
+    switch (type)
+    {
+    case EnterOrderMessage::Type:
+        return sizeof(EnterOrderMessage);
+    case CancelOrderMessage::Type:
+        return sizeof(CancelOrderMessage);
+    case ReplaceOrderMessage::Type:
+        return sizeof(ReplaceOrderMessage);
+    default:
+        return 0;
+    }
+}
+
+// hands every complete client message at the front of `buffer` to `handler` as an OrderCommand built on the stack,
+// in arrival order, and returns the bytes consumed; a message cut off at the end is left for the caller to keep
+// throws std::runtime_error on an unknown type, a length that doesn't match it, a side or order type out of range or
+// a zero quantity (a client cancels with CancelOrder), since the stream can't be resynced. type and length are checked
+// as soon as a header is in, so a bogus length is refused rather than waited for
+template<typename Handler>
+std::size_t DecodeOrderEntry(std::span<const std::byte> buffer, Handler &&handler)
+{
+    std::size_t offset = 0;
+    while (buffer.size() - offset >= sizeof(WireHeader))
+    {
+        const std::byte *data = buffer.data() + offset;
+        auto header = LoadWireMessage<WireHeader>(data);
+        std::size_t length = ClientMessageLength(header.type_);
+        if (length == 0)
+            throw std::runtime_error("order entry: unknown message type");
+        if (header.length_ != length)
+            throw std::runtime_error("order entry: bad message length");
+        if (buffer.size() - offset < length)
+            break;
+
+        switch (header.type_)
+        {
+        case EnterOrderMessage::Type:
+        {
+            auto message = LoadWireMessage<EnterOrderMessage>(data);
+            if (message.side_ > static_cast<std::uint8_t>(Side::Sell) || message.orderType_ > static_cast<std::uint8_t>(OrderType::StopLimit))
+                throw std::runtime_error("order entry: bad EnterOrder side or order type");
+            if (message.quantity_ == 0)
+                throw std::runtime_error("order entry: EnterOrder with zero quantity");
+            handler(message.ToCommand());
+            break;
+        }
+        case CancelOrderMessage::Type:
+            handler(LoadWireMessage<CancelOrderMessage>(data).ToCommand());
+            break;
+        case ReplaceOrderMessage::Type:
+        {
+            auto message = LoadWireMessage<ReplaceOrderMessage>(data);
+            if (message.side_ > static_cast<std::uint8_t>(Side::Sell))
+                throw std::runtime_error("order entry: bad ReplaceOrder side");
+            if (message.quantity_ == 0)
+                throw std::runtime_error("order entry: ReplaceOrder with zero quantity");
+            handler(message.ToCommand());
+            break;
+        }
+        }
+        offset += length;
+    }
+    return offset;
+}
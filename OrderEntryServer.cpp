@@ -0,0 +1,135 @@
+#include "OrderEntryServer.h"
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace
+{
+    //a client that hangs up mid-answer should end its session, not the process
+#if defined(MSG_NOSIGNAL)
+    constexpr int SendFlags = MSG_NOSIGNAL;
+#else
+    constexpr int SendFlags = 0;
+#endif
+
+    std::runtime_error SocketError(const char* what)
+    {
+        return std::runtime_error(std::string{"order entry server: "} + what + ": " + std::strerror(errno));
+    }
+
+    void WriteAll(int fd, const std::byte* data, std::size_t size)
+    {
+        while(size > 0) {
+            ssize_t written = ::send(fd, data, size, SendFlags);
+            if(written < 0) {
+                if(errno == EINTR) {
+                    continue;
+                }
+                throw SocketError("write failed");
+            }
+            data += written;
+            size -= static_cast<std::size_t>(written);
+        }
+    }
+}
+
+OrderEntryServer::OrderEntryServer(Orderbook& book, const std::string& path, std::size_t bufferSize)
+    : book_{book}, path_{path}, receive_(bufferSize)
+{
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if(path.size() >= sizeof(address.sun_path)) {
+        throw std::runtime_error("order entry server: socket path too long: " + path);
+    }
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+    listenFd_ = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if(listenFd_ < 0) {
+        throw SocketError("socket failed");
+    }
+    ::unlink(path.c_str());
+    if(::bind(listenFd_, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 || ::listen(listenFd_, 1) != 0) {
+        auto error = SocketError("cannot listen");
+        ::close(listenFd_);
+        throw error;
+    }
+    send_.reserve(bufferSize);
+}
+
+OrderEntryServer::~OrderEntryServer()
+{
+    ::close(listenFd_);
+    ::unlink(path_.c_str());
+}
+
+template<typename Message>
+void OrderEntryServer::Queue(const Message& message)
+{
+    std::size_t offset = send_.size();
+    send_.resize(offset + sizeof(message));
+    std::memcpy(send_.data() + offset, &message, sizeof(message));
+}
+
+std::uint64_t OrderEntryServer::ServeClient()
+{
+    int fd = ::accept(listenFd_, nullptr, nullptr);
+    if(fd < 0) {
+        throw SocketError("accept failed");
+    }
+
+    auto onTrade = [this](const Trade& trade) {
+        const auto& bid = trade.GetBidTrade();
+        const auto& ask = trade.GetAskTrade();
+        Queue(ExecutedMessage{WireHeader{sizeof(ExecutedMessage), ExecutedMessage::Type, 0}, bid.quantity_, bid.orderId_, ask.orderId_, bid.price_, ask.price_});
+    };
+    TradeSink sink{onTrade};
+    auto apply = [&](const OrderCommand& command) {
+        book_.Apply(command, sink);
+        Queue(AcceptedMessage{WireHeader{sizeof(AcceptedMessage), AcceptedMessage::Type, 0}, 0, command.orderId_});
+    };
+
+    std::uint64_t commands = 0;
+    //bytes of a message the last read cut off, kept at the front of the buffer
+    std::size_t pending = 0;
+    try {
+        while(true) {
+            //a read into no room would return 0 and look like a hangup
+            if(pending == receive_.size()) {
+                throw std::runtime_error("order entry server: message larger than the receive buffer");
+            }
+            ssize_t received = ::read(fd, receive_.data() + pending, receive_.size() - pending);
+            if(received < 0) {
+                if(errno == EINTR) {
+                    continue;
+                }
+                throw SocketError("read failed");
+            }
+            if(received == 0) {
+                break;
+            }
+            pending += static_cast<std::size_t>(received);
+
+            std::size_t consumed = DecodeOrderEntry(std::span<const std::byte>{receive_.data(), pending}, [&](const OrderCommand& command) {
+                apply(command);
+                ++commands;
+            });
+            std::memmove(receive_.data(), receive_.data() + consumed, pending - consumed);
+            pending -= consumed;
+
+            WriteAll(fd, send_.data(), send_.size());
+            send_.clear();
+        }
+    }
+    catch(...) {
+        send_.clear();
+        ::close(fd);
+        throw;
+    }
+    ::close(fd);
+    return commands;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Orderbook.h"
+#include "OrderEntry.h"
+
+// serves the binary order entry protocol (OrderEntry.h) on a Unix domain socket, one client at a time, straight into
+// the book on the calling thread: read, decode in place, apply, answer, with no queue or copy in between
+// every read's answers (executions, then one Accepted per command) go back in a single write
+class OrderEntryServer
+{
+public:
+    // binds and listens on `path`, replacing a stale socket file; throws std::runtime_error on failure
+    OrderEntryServer(Orderbook &book, const std::string &path, std::size_t bufferSize = 64 * 1024);
+    ~OrderEntryServer();
+
+    OrderEntryServer(const OrderEntryServer &) = delete;
+    OrderEntryServer &operator=(const OrderEntryServer &) = delete;
+
+    // accepts one client and serves it until it hangs up; returns the number of commands it sent
+    // throws std::runtime_error on a socket error or a malformed message, after closing the connection
+    std::uint64_t ServeClient();
+
+private:
+    template<typename Message>
+    void Queue(const Message &message);
+
+    Orderbook &book_;
+    std::string path_;
+    int listenFd_{-1};
+    std::vector<std::byte> receive_;
+    // grows to the largest burst of answers once, then is reused
+    std::vector<std::byte> send_;
+};
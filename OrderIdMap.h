@@ -0,0 +1,203 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <limits>
+#include <bit>
+#include <algorithm>
+
+#include "Usings.h"
+
+// what we need to size the id index: how full it is and how far lookups have to walk
+struct OrderIdMapStats
+{
+    std::size_t size_;
+    std::size_t capacity_;
+    double loadFactor_;
+    std::size_t maxProbeLength_;
+    double averageProbeLength_;
+    std::size_t rehashCount_;
+};
+
+// flat open-addressing table keyed on OrderId with linear probing
+// everything lives in one array, so a lookup is usually a single cache line and never allocates
+// erase shifts the following entries back instead of leaving tombstones, so probe lengths don't rot over a session
+// the largest OrderId marks empty slots, so that one id lives in a slot of its own beside the table
+template<typename Value>
+class OrderIdMap
+{
+public:
+    explicit OrderIdMap(std::size_t capacity = 0)
+    {
+        Reserve(capacity);
+    }
+
+    // sizes the table so `count` ids fit without rehashing
+    void Reserve(std::size_t count)
+    {
+        std::size_t slots = std::bit_ceil(std::max<std::size_t>(16, count * MaxLoadDenominator / MaxLoadNumerator + 1));
+        if (slots > slots_.size())
+            Rehash(slots);
+    }
+
+    std::size_t Size() const { return size_; }
+
+    Value *Find(OrderId orderId)
+    {
+        if (orderId == EmptyKey)
+            return hasEmptyKey_ ? &emptyKeyValue_ : nullptr;
+        for (std::size_t index = Home(orderId);; index = (index + 1) & mask_)
+        {
+            auto &slot = slots_[index];
+            if (slot.key_ == orderId)
+                return &slot.value_;
+            if (slot.key_ == EmptyKey)
+                return nullptr;
+        }
+    }
+
+    const Value *Find(OrderId orderId) const
+    {
+        return const_cast<OrderIdMap *>(this)->Find(orderId);
+    }
+
+    bool Contains(OrderId orderId) const { return Find(orderId) != nullptr; }
+
+    // returns false (and leaves the table alone) if the id is already present
+    bool Insert(OrderId orderId, const Value &value)
+    {
+        if (orderId == EmptyKey)
+        {
+            if (hasEmptyKey_)
+                return false;
+            hasEmptyKey_ = true;
+            emptyKeyValue_ = value;
+            ++size_;
+            return true;
+        }
+        if ((size_ + 1) * MaxLoadDenominator > slots_.size() * MaxLoadNumerator)
+            Rehash(slots_.size() * 2);
+
+        for (std::size_t index = Home(orderId);; index = (index + 1) & mask_)
+        {
+            auto &slot = slots_[index];
+            if (slot.key_ == orderId)
+                return false;
+            if (slot.key_ == EmptyKey)
+            {
+                slot.key_ = orderId;
+                slot.value_ = value;
+                ++size_;
+                return true;
+            }
+        }
+    }
+
+    bool Erase(OrderId orderId)
+    {
+        if (orderId == EmptyKey)
+        {
+            if (!hasEmptyKey_)
+                return false;
+            hasEmptyKey_ = false;
+            --size_;
+            return true;
+        }
+        std::size_t hole = Home(orderId);
+        while (slots_[hole].key_ != orderId)
+        {
+            if (slots_[hole].key_ == EmptyKey)
+                return false;
+            hole = (hole + 1) & mask_;
+        }
+
+        // backward shift: pull later entries of the same probe chain into the hole
+        for (std::size_t index = (hole + 1) & mask_; slots_[index].key_ != EmptyKey; index = (index + 1) & mask_)
+        {
+            std::size_t home = Home(slots_[index].key_);
+            if (((index - home) & mask_) >= ((index - hole) & mask_))
+            {
+                slots_[hole] = slots_[index];
+                hole = index;
+            }
+        }
+        slots_[hole].key_ = EmptyKey;
+        --size_;
+        return true;
+    }
+
+    // walks the whole table, so call it from diagnostics rather than the hot path
+    OrderIdMapStats Stats() const
+    {
+        std::size_t maxProbe = 0, totalProbe = 0;
+        for (std::size_t index = 0; index < slots_.size(); ++index)
+        {
+            if (slots_[index].key_ == EmptyKey)
+                continue;
+            std::size_t probe = ((index - Home(slots_[index].key_)) & mask_) + 1;
+            maxProbe = std::max(maxProbe, probe);
+            totalProbe += probe;
+        }
+        // the side slot is found without probing
+        if (hasEmptyKey_)
+        {
+            maxProbe = std::max<std::size_t>(maxProbe, 1);
+            ++totalProbe;
+        }
+        return OrderIdMapStats{
+            size_,
+            slots_.size(),
+            static_cast<double>(size_) / slots_.size(),
+            maxProbe,
+            size_ ? static_cast<double>(totalProbe) / size_ : 0.0,
+            rehashCount_,
+        };
+    }
+
+private:
+    static constexpr OrderId EmptyKey = std::numeric_limits<OrderId>::max();
+    // keep the table at most 70% full; linear probing degrades quickly past that
+    static constexpr std::size_t MaxLoadNumerator = 7;
+    static constexpr std::size_t MaxLoadDenominator = 10;
+
+    struct Slot
+    {
+        OrderId key_{EmptyKey};
+        Value value_{};
+    };
+
+    // fibonacci hashing spreads sequential ids across the table
+    std::size_t Home(OrderId orderId) const
+    {
+        return static_cast<std::size_t>((orderId * 0x9E3779B97F4A7C15ull) >> shift_);
+    }
+
+    void Rehash(std::size_t slotCount)
+    {
+        std::vector<Slot> old = std::move(slots_);
+        slots_.assign(slotCount, Slot{});
+        mask_ = slotCount - 1;
+        shift_ = 64 - std::countr_zero(slotCount);
+        if (!old.empty())
+            ++rehashCount_;
+
+        for (const auto &slot : old)
+        {
+            if (slot.key_ == EmptyKey)
+                continue;
+            std::size_t index = Home(slot.key_);
+            while (slots_[index].key_ != EmptyKey)
+                index = (index + 1) & mask_;
+            slots_[index] = slot;
+        }
+    }
+
+    std::vector<Slot> slots_;
+    Value emptyKeyValue_{};
+    bool hasEmptyKey_{false};
+    std::size_t size_{0};
+    std::size_t mask_{0};
+    int shift_{64};
+    std::size_t rehashCount_{0};
+};
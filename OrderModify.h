@@ -15,6 +15,11 @@ public:
     Side GetSide() const { return side_; }
     Quantity GetQuantity() const { return quantity_; }
 
+    Order ToOrder(OrderType type) const
+    {
+        return Order{type, GetOrderId(), GetSide(), GetPrice(), GetQuantity()};
+    }
+
     OrderPointer ToOrderPointer(OrderType type) const
     {
         return std::make_shared<Order>(type, GetOrderId(), GetSide(), GetPrice(), GetQuantity());
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <limits>
+
+#include "Order.h"
+
+// index of an order in the pool; stays valid until the order is freed, no matter how the pool grows
+using OrderHandle = std::uint32_t;
+constexpr OrderHandle InvalidOrderHandle = std::numeric_limits<OrderHandle>::max();
+
+constexpr Timestamp NoExpiry = std::numeric_limits<Timestamp>::max();
+
+// what matching reads and writes for every fill: the id for the trade, what's left, the owner for the
+// self-match check, and the level links
+// 24 bytes, so a sweep walks a level's queue touching little more than these records
+struct OrderHot
+{
+    OrderId orderId_;
+    Quantity remaining_;
+    // next to remaining_, so the self-match compare reads a word the fill is loading anyway
+    OwnerId owner_;
+    OrderHandle prev_{InvalidOrderHandle};
+    OrderHandle next_{InvalidOrderHandle};
+};
+
+// everything else, read on add, cancel and expiry, and inside the match loop only when an iceberg's peak runs out
+// (trades print at the level's price, so the order's own price lives here too)
+// an iceberg's hot remaining_ is only what shows; reserve_ is the hidden rest and peak_ how much of it shows at a time
+struct OrderCold
+{
+    Price price_;
+    Quantity initial_;
+    Quantity reserve_{0};
+    Quantity peak_{0};
+    OrderType type_;
+    Side side_;
+    // only read while a Stop or StopLimit waits to be triggered
+    Price stopPrice_{Constants::InvalidPrice};
+    OrderHandle expiryPrev_{InvalidOrderHandle};
+    OrderHandle expiryNext_{InvalidOrderHandle};
+    Timestamp expiry_{NoExpiry};
+};
+
+static_assert(sizeof(OrderHot) == 24);
+static_assert(sizeof(OrderCold) == 40);
+
+// slab of orders split into parallel hot and cold arrays, with a free list threaded through the hot next_
+// once the slab reaches its high-water mark, allocating an order never touches the heap
+class OrderPool
+{
+public:
+    explicit OrderPool(std::size_t capacity = 0)
+    {
+        hot_.reserve(capacity);
+        cold_.reserve(capacity);
+    }
+
+    OrderHandle Allocate(const Order &order)
+    {
+        OrderHot hot{order.GetOrderId(), order.GetDisplayQuantity(), order.GetOwnerId()};
+        OrderCold cold{order.GetPrice(), order.GetInitialQuantity(), order.GetRemainingQuantity() - order.GetDisplayQuantity(),
+            order.GetPeakQuantity(), order.GetOrderType(), order.GetSide(), order.GetStopPrice()};
+        if (freeHead_ == InvalidOrderHandle)
+        {
+            hot_.push_back(hot);
+            cold_.push_back(cold);
+            return static_cast<OrderHandle>(hot_.size() - 1);
+        }
+
+        OrderHandle handle = freeHead_;
+        freeHead_ = hot_[handle].next_;
+        hot_[handle] = hot;
+        cold_[handle] = cold;
+        return handle;
+    }
+
+    void Free(OrderHandle handle)
+    {
+        hot_[handle].prev_ = InvalidOrderHandle;
+        hot_[handle].next_ = freeHead_;
+        freeHead_ = handle;
+    }
+
+    OrderHot &Hot(OrderHandle handle) { return hot_[handle]; }
+    const OrderHot &Hot(OrderHandle handle) const { return hot_[handle]; }
+    OrderCold &Cold(OrderHandle handle) { return cold_[handle]; }
+    const OrderCold &Cold(OrderHandle handle) const { return cold_[handle]; }
+
+    // the order as it stands now, put back together from both halves
+    Order Get(OrderHandle handle) const
+    {
+        const auto &hot = hot_[handle];
+        const auto &cold = cold_[handle];
+        Order order{cold.type_, hot.orderId_, cold.side_, cold.price_, cold.initial_, hot.owner_, cold.peak_, cold.stopPrice_};
+        order.Fill(cold.initial_ - hot.remaining_ - cold.reserve_);
+        if (cold.type_ == OrderType::Iceberg)
+            order.SetDisplayQuantity(hot.remaining_);
+        return order;
+    }
+
+private:
+    std::vector<OrderHot> hot_;
+    std::vector<OrderCold> cold_;
+    OrderHandle freeHead_{InvalidOrderHandle};
+};
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "OrderPool.h"
+
+// FIFO of orders resting at one price level, linked through the pool nodes
+// the queue itself is just two handles, so an empty level costs nothing to create or reset
+class OrderQueue
+{
+public:
+    bool Empty() const { return head_ == InvalidOrderHandle; }
+    OrderHandle Front() const { return head_; }
+
+    void PushBack(OrderPool &pool, OrderHandle handle)
+    {
+        auto &node = pool.Hot(handle);
+        node.prev_ = tail_;
+        node.next_ = InvalidOrderHandle;
+        if (tail_ == InvalidOrderHandle)
+            head_ = handle;
+        else
+            pool.Hot(tail_).next_ = handle;
+        tail_ = handle;
+    }
+
+    // O(1) unlink from anywhere in the queue
+    void Erase(OrderPool &pool, OrderHandle handle)
+    {
+        auto &node = pool.Hot(handle);
+        if (node.prev_ == InvalidOrderHandle)
+            head_ = node.next_;
+        else
+            pool.Hot(node.prev_).next_ = node.next_;
+
+        if (node.next_ == InvalidOrderHandle)
+            tail_ = node.prev_;
+        else
+            pool.Hot(node.next_).prev_ = node.prev_;
+
+        node.prev_ = node.next_ = InvalidOrderHandle;
+    }
+
+    OrderHandle PopFront(OrderPool &pool)
+    {
+        OrderHandle handle = head_;
+        Erase(pool, handle);
+        return handle;
+    }
+
+    // fn gets each handle in time priority
+    template<typename Fn>
+    void ForEach(const OrderPool &pool, Fn fn) const
+    {
+        for (OrderHandle handle = head_; handle != InvalidOrderHandle; handle = pool.Hot(handle).next_)
+            fn(handle);
+    }
+
+private:
+    OrderHandle head_{InvalidOrderHandle};
+    OrderHandle tail_{InvalidOrderHandle};
+};
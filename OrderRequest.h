@@ -0,0 +1,21 @@
+#pragma once
+
+#include "Order.h"
+
+// the fields of a new order as they arrive in a batch, before the book takes ownership of them
+struct OrderRequest
+{
+    OrderType orderType_;
+    OrderId orderId_;
+    Side side_;
+    Price price_;
+    Quantity quantity_;
+    OwnerId ownerId_{Constants::NoOwner};
+    Quantity peakQuantity_{0};
+    Price stopPrice_{Constants::InvalidPrice};
+
+    Order ToOrder() const
+    {
+        return Order{orderType_, orderId_, side_, price_, quantity_, ownerId_, peakQuantity_, stopPrice_};
+    }
+};
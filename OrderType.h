@@ -1,10 +1,23 @@
 #pragma once
 
-enum class OrderType
+#include <cstdint>
+
+enum class OrderType : std::uint8_t
 {
     GoodTillCancel,
     FillAndKill,
     FillOrKill,
     GoodForDay,
     Market,
-};
\ No newline at end of file
+    // rests like GoodTillCancel but shows at most its peak; the rest is hidden and refills the peak as it trades
+    Iceberg,
+    // wait off the book until a trade prints at or through their stop price (at or above it for a buy, at or below
+    // for a sell), then come in as a Market order or, for StopLimit, a GoodTillCancel limit at their price
+    Stop,
+    StopLimit,
+};
+
+constexpr bool IsStop(OrderType type)
+{
+    return type == OrderType::Stop || type == OrderType::StopLimit;
+}
\ No newline at end of file
@@ -1,43 +1,273 @@
 #pragma once
 
 #include <map>
-#include <unordered_map>
 #include <thread>
 #include <condition_variable>
 #include <mutex>
+#include <span>
+#include <optional>
 
 #include "Usings.h"
+#include "PriceLadder.h"
 #include "Order.h"
+#include "OrderPool.h"
+#include "PriceLevel.h"
+#include "OrderIdMap.h"
+#include "ExpiryIndex.h"
 #include "OrderModify.h"
+#include "OrderCommand.h"
+#include "OrderRequest.h"
 #include "OrderbookLevelInfos.h"
 #include "Trade.h"
+#include "TradeSink.h"
+#include "TradingPhase.h"
+#include "SelfMatchPolicy.h"
+#include "AuctionResult.h"
+#include "OrderbookMetrics.h"
+#include "MarketData.h"
+#include "TopOfBook.h"
+#include "OrderbookPolicy.h"
 
-class Orderbook
+// Policy picks the level container, the id index and the locking at compile time (see OrderbookPolicy.h);
+// the member definitions live in OrderBook.cpp and are instantiated there for the policies it lists
+template<typename Policy>
+class BasicOrderbook
 {
     private:
         struct OrderEntry
         {
-            OrderPointer order_{nullptr};
-            OrderPointers::iterator location_;
+            OrderHandle location_{InvalidOrderHandle};
+        };
+
+        // an accepted order from an AddOrders burst; sequence_ is its position in the request span
+        struct BatchEntry
+        {
+            OrderHandle handle_;
+            std::uint32_t sequence_;
         };
         
         
         
-        std::map<Price, OrderPointers, std::greater<Price>> bids_;
-        std::map<Price, OrderPointers, std::less<Price>> asks_;
-        std::unordered_map<OrderId, OrderEntry> orders_;
+        OrderPool pool_;
+        typename Policy::template Levels<PriceLevel, std::greater<Price>> bids_;
+        typename Policy::template Levels<PriceLevel, std::less<Price>> asks_;
+        typename Policy::template IdIndex<OrderEntry> orders_;
+        // pending stops by stop price, best being the next to trigger: buy stops fire as prices rise, lowest stop first,
+        // sell stops as they fall, highest first. a print takes whole levels off the front, so it costs O(log n) plus the
+        // stops it sets off however many are waiting. these stay in the tree, off the band, since stops are few and spread
+        typename Policy::template Levels<PriceLevel, std::less<Price>> buyStops_;
+        typename Policy::template Levels<PriceLevel, std::greater<Price>> sellStops_;
+        // stops set off during the current command, already out of the pool and index, waiting to go in through AddOrder
+        std::vector<Order> triggered_;
+        bool activating_{false};
+        // scratch for AddOrders, kept around so bursts stop allocating once it has grown
+        std::vector<BatchEntry> batch_;
+        TradingPhase phase_{TradingPhase::Continuous};
+        SelfMatchPolicy selfMatchPolicy_{SelfMatchPolicy::CancelResting};
+        ExpiryIndex expiries_;
+        // resting icebergs; while there are none, an order filling in the match loop never reads its cold half
+        std::size_t icebergs_{0};
+        Timestamp sessionEnd_{NoExpiry};
+        // breaks uncross ties that volume and imbalance leave open; unset, the lower price wins
+        std::optional<Price> referencePrice_;
+        // crossed levels collected while searching for the uncross price, reused between auctions
+        mutable LevelInfos crossedBids_;
+        mutable LevelInfos crossedAsks_;
+        ORDERBOOK_METRIC(OrderbookMetrics metrics_;)
+        MarketDataFeed marketData_;
+        // the matcher's copy of what it last published, so unchanged tops don't make readers retry
+        TopOfBook top_;
+        TopOfBookCell topCell_;
+        [[no_unique_address]] mutable typename Policy::Mutex mutex_;
+        using Guard = std::lock_guard<typename Policy::Mutex>;
+
+        // every public command opens one: it holds the policy's lock, and level updates and the top of book go out when
+        // the outermost scope closes
+        class CommandScope
+        {
+            public:
+                explicit CommandScope(BasicOrderbook& book) : guard_{book.mutex_}, book_{book} { book_.marketData_.BeginCommand(); }
+                ~CommandScope()
+                {
+                    if(book_.marketData_.EndCommand()) {
+                        book_.marketData_.Flush(book_.bids_, book_.asks_);
+                        book_.PublishTopOfBook();
+                    }
+                }
+
+            private:
+                Guard guard_;
+                BasicOrderbook& book_;
+        };
 
 
 
         bool CanMatch(Side side, Price price) const;
-        Trades MatchOrders();
+        // FillOrKill feasibility: can `quantity` trade at `price` or better right now, not counting liquidity the
+        // self-match policy would take away from an order of `owner`
+        bool CanFullyFill(Side side, Price price, Quantity quantity, OwnerId owner) const;
+        // aggressor is the side of the order that just arrived, if a single order did; self-matches depend on it
+        void MatchOrders(TradeSink sink, std::optional<Side> aggressor = std::nullopt);
+        // returns the number of fills
+        std::size_t MatchBestLevels(Price bidTradePrice, Price askTradePrice, TradeSink sink, std::optional<Side> aggressor);
+        // a market order never rests: it takes `ladder`'s levels best first until it is done or the side runs out,
+        // and whatever is left is dropped. the order itself never touches the pool, the id index or a level
+        template<typename Ladder>
+        void SweepMarketOrder(Ladder& ladder, Side restingSide, const Order& order, TradeSink sink);
+        // the fronts of the two best levels share an owner: applies the self-match policy to them instead of a fill
+        void ResolveSelfMatch(PriceLevel& bids, Price bidPrice, PriceLevel& asks, Price askPrice, std::optional<Side> aggressor,
+            Quantity& matched);
+        // puts a pooled order on the back of the level its side and price say, keeping the level totals in step
+        void LinkOrder(OrderHandle handle);
+        // takes it off its level again (dropping the level if that empties it); the node itself stays allocated
+        void UnlinkOrder(OrderHandle handle);
+        // drops an order that has already left its level from the id index, the expiry lists and the pool
+        void ReleaseOrder(OrderHandle handle);
+        // an order whose showing quantity just ran out and was popped off `level`: if it is an iceberg with some reserve
+        // left, shows the next peak and puts the same node back on the end of the level (the ladder gains the peak).
+        // returns false, touching nothing, when there is nothing left to show and the caller should release it
+        bool Replenish(PriceLevel& level, OrderHandle handle);
+        // icebergs' hidden reserves resting at a level; walks the level, so callers check icebergs_ first
+        Quantity HiddenQuantity(const PriceLevel& level) const;
+        // a pending stop's place among the other stops, by side and stop price
+        void LinkStop(OrderHandle handle);
+        void UnlinkStop(OrderHandle handle);
+        // a trade printed: queues every buy stop at or below buyPrint and then every sell stop at or above sellPrint,
+        // each side in trigger order, and releases them from the pool and index
+        void TriggerStops(Price buyPrint, Price sellPrint);
+        // feeds the triggered stops through AddOrder in the order they triggered, stops that those set off queueing behind
+        // them; nested calls return at once, so the outermost command's call does it all without recursing
+        void ActivateStops(TradeSink sink);
+        void ScheduleExpiry(OrderHandle handle);
+        void PublishTopOfBook();
 
     public:
-        Orderbook();
+        BasicOrderbook();
+        // ladder mode: prices inside the band get a flat array slot, the rest fall back to the tree
+        // orderCapacity presizes the order pool and id index so neither grows during the session
+        explicit BasicOrderbook(LadderBand band, std::size_t orderCapacity = 0);
         Trades AddOrder(OrderPointer order);
+        // the order is copied into the book's pool, so callers don't need to heap allocate it
+        Trades AddOrder(const Order& order);
+        // trades go straight to the sink as they happen; nothing is allocated on the way
+        // Market orders trade at each resting order's price and never rest; outside continuous trading they are dropped
+        // an Iceberg shows its peak; each time that fills the next peak shows at the back of the level, until the reserve is gone
+        // a Stop or StopLimit waits off the book. a trade prints at the resting order's price (both sides' prices when a
+        // burst or auction has no single aggressor: the ask's for buy stops, the bid's for sell stops). once the command
+        // that printed is done, the stops it triggered come back through here as Market or GoodTillCancel orders, so the
+        // phase rules apply to them as they stand then
+        void AddOrder(const Order& order, TradeSink sink);
+        // a burst is treated as arriving at once in span order: duplicates are dropped in one pass, orders are
+        // inserted level by level, and the book is matched once at the end. FillAndKill leftovers are cancelled afterwards
+        // and any stops that set off are activated, then FillOrKill, Market and stop requests go through AddOrder one by one
+        // in span order. During an auction nothing matches, and the deferred requests meet the auction rules of AddOrder
+        Trades AddOrders(std::span<const OrderRequest> requests);
+        void AddOrders(std::span<const OrderRequest> requests, TradeSink sink);
         void CancelOrder(OrderId orderId);
+        void CancelOrders(std::span<const OrderId> orderIds);
+        // the modify's quantity is the new open quantity (0 cancels), hidden reserve included for an Iceberg. same side and
+        // price with no more quantity than is open reduces in place and keeps time priority; anything else moves the order
+        // to the back of its new level. a pending stop can only be cancelled this way (quantity 0); other modifies leave it be
         Trades ModifyOrder(OrderModify order);
+        void ModifyOrder(OrderModify order, TradeSink sink);
+        // dispatches a queued/recorded command to AddOrder, CancelOrder or ModifyOrder, or to the session call it names
+        void Apply(const OrderCommand& command, TradeSink sink);
+        // GoodForDay orders added from now on expire at sessionEnd; until this is set they behave like GoodTillCancel
+        void SetSessionEnd(Timestamp sessionEnd)
+        {
+            Guard guard{mutex_};
+            sessionEnd_ = sessionEnd;
+        }
+        Timestamp GetSessionEnd() const
+        {
+            Guard guard{mutex_};
+            return sessionEnd_;
+        }
+        // applies to crosses between orders with the same owner; orders without one (NoOwner) always trade
+        void SetSelfMatchPolicy(SelfMatchPolicy policy)
+        {
+            Guard guard{mutex_};
+            selfMatchPolicy_ = policy;
+        }
+        SelfMatchPolicy GetSelfMatchPolicy() const
+        {
+            Guard guard{mutex_};
+            return selfMatchPolicy_;
+        }
+        // cancels every order whose expiry is at or before `now`, in O(expired); driven by the owner's clock,
+        // so a matching thread calls it between commands and tests can feed it simulated time
+        std::size_t ExpireOrders(Timestamp now);
+        TradingPhase GetPhase() const
+        {
+            Guard guard{mutex_};
+            return phase_;
+        }
+        // Continuous/Closed -> Auction; orders keep arriving but nothing matches until Uncross
+        void OpenAuction();
+        // Auction/Continuous -> Closed
+        void CloseBook();
+        // typically the last trade or the previous close; among uncross prices with the same volume and imbalance the
+        // one nearest it wins
+        void SetReferencePrice(Price price)
+        {
+            Guard guard{mutex_};
+            referencePrice_ = price;
+        }
+        std::optional<Price> GetReferencePrice() const
+        {
+            Guard guard{mutex_};
+            return referencePrice_;
+        }
+        // price that would maximise executed volume if the auction uncrossed now
+        AuctionResult GetIndicativeUncross() const;
+        // Auction -> next: executes everything that crosses at the equilibrium price in one pass
+        // outside an auction it does nothing and returns a zero-volume result. The uncross print sets stops off only when
+        // next is Continuous; uncrossing into another phase leaves them pending
+        AuctionResult Uncross(TradeSink sink, TradingPhase next = TradingPhase::Continuous);
+        // visits every resting order (rebuilt from the pool's hot and cold halves) with its expiry: bids then asks,
+        // best level first, time priority within a level, then the pending stops in trigger order
+        // allocation-free, so it is safe to call from a forked snapshot child
+        template<typename Fn>
+        void ForEachOrder(Fn fn) const
+        {
+            Guard guard{mutex_};
+            auto visitLevel = [&](Price, const PriceLevel& level) {
+                for(OrderHandle handle = level.Front(); handle != InvalidOrderHandle; handle = pool_.Hot(handle).next_) {
+                    fn(pool_.Get(handle), pool_.Cold(handle).expiry_);
+                }
+            };
+            bids_.ForEach(visitLevel);
+            asks_.ForEach(visitLevel);
+            buyStops_.ForEach(visitLevel);
+            sellStops_.ForEach(visitLevel);
+        }
+        // puts an order back at the end of its level (or a stop among the pending ones) exactly as given (remaining
+        // quantity, expiry), without matching; used to load snapshots
+        void RestoreOrder(const Order& order, Timestamp expiry);
+        // level updates coalesced per command go to `sink`, starting with a full-depth snapshot right away;
+        // with snapshotInterval > 0 another snapshot follows every that many commands, for consumers that lost their place
+        // capacity presizes the per-command buffers
+        void SetMarketDataSink(MarketDataSink sink, std::uint64_t snapshotInterval = 0, std::size_t capacity = 256);
+        void PublishMarketDataSnapshot();
+        // best bid and ask as of the last completed command; never takes the book's lock or waits on the matcher,
+        // so strategy threads can poll it from other cores as often as they like
+        TopOfBook GetTopOfBook() const { return topCell_.Read(); }
+        // resting orders plus pending stops
         std::size_t Size() const;
+        OrderIdMapStats GetOrderIdStats() const;
+        // level quantities (here, in the top of book and in market data) are what shows: icebergs count their peak only
         OrderbookLevelInfos GetOrderInfos() const;
+        // top-of-book depth: fills at most bids.size() / asks.size() levels, best first, without allocating
+        LevelInfoCounts GetOrderInfos(std::span<LevelInfo> bids, std::span<LevelInfo> asks) const;
+#if defined(ORDERBOOK_METRICS)
+        // the reference stays valid for the book's lifetime and may be polled from any thread while the book runs
+        const OrderbookMetrics& GetMetrics() const { return metrics_; }
+#endif
+
+};
+
+extern template class BasicOrderbook<DefaultOrderbookPolicy>;
+extern template class BasicOrderbook<LockedOrderbookPolicy>;
+extern template class BasicOrderbook<StdIndexOrderbookPolicy>;
 
-};
\ No newline at end of file
+using Orderbook = BasicOrderbook<DefaultOrderbookPolicy>;
\ No newline at end of file
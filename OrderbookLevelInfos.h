@@ -1,7 +1,16 @@
 #pragma once
 
+#include <cstddef>
+
 #include "LevelInfo.h"
 
+// how many levels per side a depth snapshot wrote
+struct LevelInfoCounts
+{
+    std::size_t bids_;
+    std::size_t asks_;
+};
+
 class OrderbookLevelInfos
 {
 public:
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#include "Constants.h"
+#include "CycleClock.h"
+#include "Histogram.h"
+
+// build with -DORDERBOOK_METRICS to instrument Orderbook; without it every ORDERBOOK_METRIC(...) expands to nothing
+// and the book carries no metrics at all
+#if defined(ORDERBOOK_METRICS)
+#define ORDERBOOK_METRIC(...) __VA_ARGS__
+#else
+#define ORDERBOOK_METRIC(...)
+#endif
+
+// written by the book's thread only, readable from any thread
+class MetricCounter
+{
+public:
+    void Add(std::uint64_t amount = 1) { value_.store(value_.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed); }
+    void RaiseTo(std::uint64_t value)
+    {
+        if (value > value_.load(std::memory_order_relaxed))
+            value_.store(value, std::memory_order_relaxed);
+    }
+    std::uint64_t Load() const { return value_.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<std::uint64_t> value_{0};
+};
+
+// latencies are in ReadCycles() ticks (see CyclesPerNanosecond) and start once the book's lock is held, so they leave
+// out lock waits. operations nest: an add's or a modify's time includes the match it triggers, which also lands in its
+// own histogram, but an add or cancel run inside another command (a triggered stop, a modify's cancel) isn't counted again
+// on its own cache lines, so a monitoring thread polling it doesn't keep pulling the book's lines away
+struct alignas(Constants::CacheLineSize) OrderbookMetrics
+{
+    Histogram add_;
+    Histogram cancel_;
+    Histogram modify_;
+    // only match passes that actually traded
+    Histogram match_;
+    // trades generated by each aggressing match pass
+    Histogram fillsPerAggressor_;
+    MetricCounter levelsCreated_;
+    MetricCounter levelsDestroyed_;
+    // most price levels a single match pass has walked through
+    MetricCounter maxSweepDepth_;
+    // crosses between two orders of the same owner that were resolved by the self-match policy instead of trading
+    MetricCounter selfMatches_;
+};
+
+// records the cycles between construction and destruction, so every early return is covered; with record false it
+// does nothing at all
+class ScopedCycles
+{
+public:
+    ScopedCycles(Histogram &histogram, bool record) : histogram_{record ? &histogram : nullptr}, start_{record ? ReadCycles() : 0} {}
+    ~ScopedCycles()
+    {
+        if (histogram_)
+            histogram_->Record(ReadCycles() - start_);
+    }
+
+    ScopedCycles(const ScopedCycles &) = delete;
+    ScopedCycles &operator=(const ScopedCycles &) = delete;
+
+private:
+    Histogram *histogram_;
+    std::uint64_t start_;
+};
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <mutex>
+
+#include "PriceLadder.h"
+#include "OrderIdMap.h"
+#include "StdOrderIdMap.h"
+
+// a lock that isn't one: with it every guard in the book compiles away
+struct NoLock
+{
+    void lock() {}
+    void unlock() {}
+    bool try_lock() { return true; }
+};
+
+// what Orderbook is built from, picked at compile time:
+//   Levels<Level, Compare>  one side of the book (PriceLadder interface)
+//   IdIndex<Value>          order id -> location (OrderIdMap interface)
+//   Mutex                   taken by every public call; commands nest, so a real mutex has to be recursive
+// the default is the single-threaded layout everything else in the tree uses
+struct DefaultOrderbookPolicy
+{
+    template<typename Level, typename Compare>
+    using Levels = PriceLadder<Level, Compare>;
+    template<typename Value>
+    using IdIndex = OrderIdMap<Value>;
+    using Mutex = NoLock;
+};
+
+// for books shared between threads without a matching thread in front of them
+struct LockedOrderbookPolicy : DefaultOrderbookPolicy
+{
+    using Mutex = std::recursive_mutex;
+};
+
+// node-based id index, for comparing against the flat one
+struct StdIndexOrderbookPolicy : DefaultOrderbookPolicy
+{
+    template<typename Value>
+    using IdIndex = StdOrderIdMap<Value>;
+};
@@ -0,0 +1,264 @@
+#pragma once
+
+#include <map>
+#include <vector>
+#include <bit>
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+#include <type_traits>
+#include <algorithm>
+
+#include "Usings.h"
+#include "FenwickTree.h"
+
+// the band of prices that live in the flat array; anything outside it (or off the tick grid) goes in the tree
+struct LadderBand
+{
+    Price basePrice_{0};
+    Price tickSize_{1};
+    std::size_t levelCount_{0};
+};
+
+// one side of the book. levels inside the band sit in a contiguous array indexed by (price - base) / tick,
+// so finding a level is arithmetic instead of a red-black tree walk
+// Compare decides which price is "better": std::greater for bids, std::less for asks
+template<typename Level, typename Compare>
+class PriceLadder
+{
+public:
+    static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+    PriceLadder() = default;
+
+    explicit PriceLadder(LadderBand band)
+        : band_{band}, levels_(band.levelCount_), occupied_((band.levelCount_ + 63) / 64), depth_{band.levelCount_}
+    {
+    }
+
+    bool Empty() const { return best_ == npos && tree_.empty(); }
+    std::size_t LevelCount() const { return bandLevels_ + tree_.size(); }
+
+    Price BestPrice() const
+    {
+        if (BestIsInBand())
+            return ToPrice(best_);
+        return tree_.begin()->first;
+    }
+
+    Level &Best()
+    {
+        if (BestIsInBand())
+            return levels_[best_];
+        return tree_.begin()->second;
+    }
+
+    // get or create the level at this price
+    Level &operator[](Price price)
+    {
+        std::size_t index = ToIndex(price);
+        if (index == npos)
+            return tree_[price];
+
+        if (!IsOccupied(index))
+        {
+            occupied_[index / 64] |= std::uint64_t{1} << (index % 64);
+            ++bandLevels_;
+            if (best_ == npos || IsBetter(index, best_))
+                best_ = index;
+        }
+        return levels_[index];
+    }
+
+    // nullptr if nothing rests at this price
+    const Level *Find(Price price) const
+    {
+        std::size_t index = ToIndex(price);
+        if (index == npos)
+        {
+            auto it = tree_.find(price);
+            return it == tree_.end() ? nullptr : &it->second;
+        }
+        return IsOccupied(index) ? &levels_[index] : nullptr;
+    }
+
+    Level &At(Price price)
+    {
+        std::size_t index = ToIndex(price);
+        if (index == npos)
+            return tree_.at(price);
+        return levels_[index];
+    }
+
+    // drop an (empty) level; if it was the best one we scan the bitmap for the next occupied slot
+    void Erase(Price price)
+    {
+        std::size_t index = ToIndex(price);
+        if (index == npos)
+        {
+            tree_.erase(price);
+            return;
+        }
+        if (!IsOccupied(index))
+            return;
+
+        occupied_[index / 64] &= ~(std::uint64_t{1} << (index % 64));
+        levels_[index] = Level{};
+        --bandLevels_;
+        if (index == best_)
+            best_ = NextWorse(index);
+    }
+
+    // callers report every change to a level's resting quantity here, so QuantityAtOrBetter never walks orders
+    // only band levels are indexed; tree levels are read straight from Level::quantity_
+    void OnQuantityChanged(Price price, std::int64_t delta)
+    {
+        std::size_t index = ToIndex(price);
+        if (index == npos)
+            return;
+        depth_.Add(index, delta);
+        bandQuantity_ += delta;
+    }
+
+    // total quantity resting at `limit` or better: O(log levels) for the band plus the (rare) tree levels in range
+    std::int64_t QuantityAtOrBetter(Price limit) const
+    {
+        std::int64_t quantity = 0;
+        if (band_.levelCount_ != 0)
+        {
+            std::int64_t offset = std::int64_t{limit} - band_.basePrice_;
+            if constexpr (HigherIsBetter)
+            {
+                // prices >= limit: everything above the first slot at or over the limit
+                std::int64_t first = offset <= 0 ? 0 : (offset + band_.tickSize_ - 1) / band_.tickSize_;
+                if (first < static_cast<std::int64_t>(band_.levelCount_))
+                    quantity += bandQuantity_ - (first == 0 ? 0 : depth_.Prefix(static_cast<std::size_t>(first - 1)));
+            }
+            else
+            {
+                // prices <= limit: everything up to the last slot at or under the limit
+                if (offset >= 0)
+                    quantity += depth_.Prefix(std::min<std::size_t>(static_cast<std::size_t>(offset / band_.tickSize_), band_.levelCount_ - 1));
+            }
+        }
+
+        for (auto it = tree_.begin(); it != tree_.end() && !Compare{}(limit, it->first); ++it)
+            quantity += it->second.quantity_;
+        return quantity;
+    }
+
+    // visits up to `limit` levels best price first, merging the array and the tree
+    // if fn returns bool, returning false stops the walk
+    template<typename Fn>
+    void ForEach(Fn fn, std::size_t limit = npos) const
+    {
+        std::size_t index = best_;
+        auto it = tree_.begin();
+        for (; limit != 0 && (index != npos || it != tree_.end()); --limit)
+        {
+            if (it == tree_.end() || (index != npos && Compare{}(ToPrice(index), it->first)))
+            {
+                if (!Visit(fn, ToPrice(index), levels_[index]))
+                    return;
+                index = NextWorse(index);
+            }
+            else
+            {
+                if (!Visit(fn, it->first, it->second))
+                    return;
+                ++it;
+            }
+        }
+    }
+
+private:
+    template<typename Fn>
+    static bool Visit(Fn &fn, Price price, const Level &level)
+    {
+        if constexpr (std::is_same_v<std::invoke_result_t<Fn &, Price, const Level &>, bool>)
+            return fn(price, level);
+        else
+        {
+            fn(price, level);
+            return true;
+        }
+    }
+
+    // true for bids, where a higher index is a better price
+    static constexpr bool HigherIsBetter = Compare{}(1, 0);
+
+    std::size_t ToIndex(Price price) const
+    {
+        std::int64_t offset = std::int64_t{price} - band_.basePrice_;
+        if (offset < 0 || offset % band_.tickSize_ != 0)
+            return npos;
+        std::size_t index = static_cast<std::size_t>(offset / band_.tickSize_);
+        return index < band_.levelCount_ ? index : npos;
+    }
+
+    Price ToPrice(std::size_t index) const
+    {
+        return static_cast<Price>(band_.basePrice_ + static_cast<std::int64_t>(index) * band_.tickSize_);
+    }
+
+    bool IsOccupied(std::size_t index) const { return (occupied_[index / 64] >> (index % 64)) & 1; }
+    bool IsBetter(std::size_t lhs, std::size_t rhs) const { return HigherIsBetter ? lhs > rhs : lhs < rhs; }
+
+    bool BestIsInBand() const
+    {
+        if (best_ == npos)
+            return false;
+        return tree_.empty() || Compare{}(ToPrice(best_), tree_.begin()->first);
+    }
+
+    std::size_t NextWorse(std::size_t index) const
+    {
+        if constexpr (HigherIsBetter)
+            return index == 0 ? npos : ScanDown(index - 1);
+        else
+            return ScanUp(index + 1);
+    }
+
+    // highest occupied index <= index
+    std::size_t ScanDown(std::size_t index) const
+    {
+        std::size_t word = index / 64;
+        std::uint64_t bits = occupied_[word] & (~std::uint64_t{0} >> (63 - index % 64));
+        while (true)
+        {
+            if (bits)
+                return word * 64 + 63 - std::countl_zero(bits);
+            if (word == 0)
+                return npos;
+            bits = occupied_[--word];
+        }
+    }
+
+    // lowest occupied index >= index
+    std::size_t ScanUp(std::size_t index) const
+    {
+        if (index >= band_.levelCount_)
+            return npos;
+        std::size_t word = index / 64;
+        std::uint64_t bits = occupied_[word] & (~std::uint64_t{0} << (index % 64));
+        while (true)
+        {
+            if (bits)
+                return word * 64 + std::countr_zero(bits);
+            if (++word == occupied_.size())
+                return npos;
+            bits = occupied_[word];
+        }
+    }
+
+    LadderBand band_;
+    std::vector<Level> levels_;
+    std::vector<std::uint64_t> occupied_;
+    std::size_t best_{npos};
+    std::size_t bandLevels_{0};
+    // resting quantity per band slot, for depth-at-price queries
+    FenwickTree depth_;
+    std::int64_t bandQuantity_{0};
+    // fallback for prices outside the band
+    std::map<Price, Level, Compare> tree_;
+};
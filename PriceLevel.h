@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+
+#include "OrderQueue.h"
+
+// a price level on one side of the book: the FIFO of orders plus running totals,
+// so depth snapshots read the totals instead of walking every order
+struct PriceLevel
+{
+    OrderQueue orders_;
+    Quantity quantity_{0};
+    std::uint32_t count_{0};
+
+    bool Empty() const { return orders_.Empty(); }
+    OrderHandle Front() const { return orders_.Front(); }
+
+    void PushBack(OrderPool &pool, OrderHandle handle)
+    {
+        orders_.PushBack(pool, handle);
+        quantity_ += pool.Hot(handle).remaining_;
+        ++count_;
+    }
+
+    void Erase(OrderPool &pool, OrderHandle handle)
+    {
+        quantity_ -= pool.Hot(handle).remaining_;
+        --count_;
+        orders_.Erase(pool, handle);
+    }
+
+    OrderHandle PopFront(OrderPool &pool)
+    {
+        OrderHandle handle = orders_.Front();
+        Erase(pool, handle);
+        return handle;
+    }
+
+    // call after filling an order resting at this level
+    void OnFill(Quantity quantity) { quantity_ -= quantity; }
+};
@@ -0,0 +1,106 @@
+#include "Replay.h"
+
+#include <random>
+#include <vector>
+
+namespace
+{
+    // FNV-1a, one 64-bit word at a time
+    constexpr std::uint64_t HashSeed = 0xcbf29ce484222325ull;
+
+    std::uint64_t HashCombine(std::uint64_t hash, std::uint64_t value)
+    {
+        return (hash ^ value) * 0x100000001b3ull;
+    }
+}
+
+ReplayResult Replay(std::span<const EventRecord> events, Orderbook& book)
+{
+    ReplayResult result{0, 0, HashSeed, 0};
+    auto hashTrade = [&result](const Trade& trade) {
+        const auto& bid = trade.GetBidTrade();
+        const auto& ask = trade.GetAskTrade();
+        result.tradeHash_ = HashCombine(result.tradeHash_, bid.orderId_);
+        result.tradeHash_ = HashCombine(result.tradeHash_, ask.orderId_);
+        result.tradeHash_ = HashCombine(result.tradeHash_, static_cast<std::uint32_t>(bid.price_));
+        result.tradeHash_ = HashCombine(result.tradeHash_, static_cast<std::uint32_t>(ask.price_));
+        result.tradeHash_ = HashCombine(result.tradeHash_, bid.quantity_);
+        ++result.trades_;
+    };
+    TradeSink sink{hashTrade};
+
+    for(const auto& event : events) {
+        book.ExpireOrders(event.timestamp_);
+        book.Apply(event.ToCommand(), sink);
+    }
+
+    result.events_ = events.size();
+    result.bookHash_ = HashBook(book);
+    return result;
+}
+
+std::uint64_t HashBook(const Orderbook& book)
+{
+    std::uint64_t hash = HashSeed;
+    auto infos = book.GetOrderInfos();
+    for(const auto* side : {&infos.GetBids(), &infos.GetAsks()}) {
+        hash = HashCombine(hash, side->size());
+        for(const auto& level : *side) {
+            hash = HashCombine(hash, static_cast<std::uint32_t>(level.price_));
+            hash = HashCombine(hash, level.quantity_);
+            hash = HashCombine(hash, level.count_);
+        }
+    }
+    return hash;
+}
+
+void GenerateEventLog(const std::string& path, std::uint64_t count, std::uint64_t seed)
+{
+    EventLogWriter writer{path};
+    std::mt19937_64 rng{seed};
+    std::normal_distribution<double> offset{0.0, 8.0};
+    std::exponential_distribution<double> gap{1.0 / 1000.0};
+    std::uniform_int_distribution<Quantity> quantity{1, 200};
+
+    std::vector<OrderId> live;
+    OrderId nextId = 1;
+    Timestamp now = 0;
+    Price mid = 10'000;
+
+    for(std::uint64_t i = 0; i < count; ++i) {
+        now += static_cast<Timestamp>(gap(rng)) + 1;
+        if(rng() % 1000 == 0) {
+            mid += rng() % 2 ? 1 : -1;
+        }
+
+        OrderCommand command{};
+        unsigned roll = rng() % 100;
+        if(roll < 30 && !live.empty()) {
+            std::size_t pick = rng() % live.size();
+            command.type_ = CommandType::Cancel;
+            command.orderId_ = live[pick];
+            live[pick] = live.back();
+            live.pop_back();
+        }
+        else if(roll < 38 && !live.empty()) {
+            command.type_ = CommandType::Modify;
+            command.orderId_ = live[rng() % live.size()];
+            command.side_ = rng() % 2 ? Side::Buy : Side::Sell;
+            command.price_ = mid + static_cast<Price>(offset(rng));
+            command.quantity_ = quantity(rng);
+        }
+        else {
+            command.type_ = CommandType::Add;
+            command.orderType_ = rng() % 20 == 0 ? OrderType::FillAndKill : OrderType::GoodTillCancel;
+            command.orderId_ = nextId++;
+            command.side_ = rng() % 2 ? Side::Buy : Side::Sell;
+            //buys lean below mid and sells above, so most orders rest and a few cross
+            Price skew = command.side_ == Side::Buy ? -3 : 3;
+            command.price_ = mid + skew + static_cast<Price>(offset(rng));
+            command.quantity_ = quantity(rng);
+            live.push_back(command.orderId_);
+        }
+        writer.Append(EventRecord::FromCommand(now, command));
+    }
+    writer.Flush();
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <string>
+
+#include "EventLog.h"
+#include "Orderbook.h"
+
+struct ReplayResult
+{
+    std::uint64_t events_;
+    std::uint64_t trades_;
+    // order-sensitive hash of every trade, so two runs that trade differently can't collide by accident
+    std::uint64_t tradeHash_;
+    std::uint64_t bookHash_;
+};
+
+// feeds every record through the book in log order; each record's timestamp also drives order expiry,
+// so replaying the same log always ends in the same book. stops with std::runtime_error at a corrupt record, leaving
+// the book as the records before it made it
+ReplayResult Replay(std::span<const EventRecord> events, Orderbook &book);
+
+// hash of the visible book (every level's price, quantity and order count on both sides)
+std::uint64_t HashBook(const Orderbook &book);
+
+// writes a synthetic session of `count` records to `path`: adds around a drifting mid, cancels and modifies of live
+// orders, steady timestamps. the same seed always gives the same log
+void GenerateEventLog(const std::string &path, std::uint64_t count, std::uint64_t seed);
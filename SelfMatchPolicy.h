@@ -0,0 +1,15 @@
+#pragma once
+
+#include <cstdint>
+
+// what the match loop does when the two orders at the front of the book share an owner (other than NoOwner)
+// CancelResting: the resting order is cancelled and the aggressor carries on down the book
+// CancelAggressor: the aggressor is cancelled, the resting order keeps its place
+// DecrementBoth: both give up the smaller of their open quantities without trading
+// a match with no aggressor (an uncross, or two orders landing in the same AddOrders burst) always decrements both
+enum class SelfMatchPolicy : std::uint8_t
+{
+    CancelResting,
+    CancelAggressor,
+    DecrementBoth,
+};
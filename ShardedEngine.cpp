@@ -0,0 +1,150 @@
+#include "ShardedEngine.h"
+
+#include "ThreadAffinity.h"
+
+namespace
+{
+    constexpr std::size_t DrainBatch = 64;
+}
+
+ShardedEngine::Shard::Shard(std::size_t producerCount, std::size_t ringCapacity)
+    : trades_{ringCapacity}
+{
+    ingress_.reserve(producerCount);
+    for(std::size_t i = 0; i < producerCount; ++i) {
+        ingress_.push_back(std::make_unique<SpscRing<RoutedCommand>>(ringCapacity));
+    }
+}
+
+ShardedEngine::ShardedEngine(std::size_t shardCount, std::size_t producerCount, std::size_t ringCapacity)
+{
+    shards_.reserve(shardCount);
+    for(std::size_t i = 0; i < shardCount; ++i) {
+        shards_.push_back(std::make_unique<Shard>(producerCount, ringCapacity));
+    }
+}
+
+ShardedEngine::~ShardedEngine()
+{
+    Stop();
+}
+
+void ShardedEngine::AddInstrument(InstrumentId instrumentId, LadderBand band, std::size_t orderCapacity)
+{
+    shards_[ShardOf(instrumentId)]->books_.try_emplace(instrumentId, band, orderCapacity);
+}
+
+void ShardedEngine::Start(int firstCpu)
+{
+    stop_.store(false, std::memory_order_release);
+    for(std::size_t i = 0; i < shards_.size(); ++i) {
+        Shard& shard = *shards_[i];
+        int cpu = firstCpu < 0 ? -1 : firstCpu + static_cast<int>(i);
+        shard.thread_ = std::thread{[this, &shard, cpu] {
+            PinCurrentThread(cpu);
+            Run(shard);
+        }};
+    }
+}
+
+void ShardedEngine::Stop()
+{
+    stop_.store(true, std::memory_order_release);
+    for(auto& shard : shards_) {
+        if(shard->thread_.joinable()) {
+            shard->thread_.join();
+        }
+    }
+}
+
+void ShardedEngine::Submit(std::size_t producer, InstrumentId instrumentId, const OrderCommand& command)
+{
+    shards_[ShardOf(instrumentId)]->ingress_[producer]->Push(RoutedCommand{instrumentId, command});
+}
+
+ShardStats ShardedEngine::GetShardStats(std::size_t shard) const
+{
+    const Shard& s = *shards_[shard];
+    return ShardStats{
+        s.books_.size(),
+        s.commandsProcessed_.load(std::memory_order_relaxed),
+        s.tradesPublished_.load(std::memory_order_relaxed),
+        s.commandsRejected_.load(std::memory_order_relaxed),
+    };
+}
+
+Orderbook* ShardedEngine::Book(InstrumentId instrumentId)
+{
+    auto& books = shards_[ShardOf(instrumentId)]->books_;
+    auto it = books.find(instrumentId);
+    return it == books.end() ? nullptr : &it->second;
+}
+
+const Orderbook* ShardedEngine::Book(InstrumentId instrumentId) const
+{
+    const auto& books = shards_[ShardOf(instrumentId)]->books_;
+    auto it = books.find(instrumentId);
+    return it == books.end() ? nullptr : &it->second;
+}
+
+void ShardedEngine::Run(Shard& shard)
+{
+    while(true) {
+        ExpireOrders(shard);
+
+        if(DrainOnce(shard)) {
+            continue;
+        }
+        if(stop_.load(std::memory_order_acquire) && !DrainOnce(shard)) {
+            return;
+        }
+        CpuRelax();
+    }
+}
+
+void ShardedEngine::ExpireOrders(Shard& shard)
+{
+    //a shard can own thousands of books, so sweep them on a cadence instead of every pass
+    Timestamp now = clock_();
+    if(now < shard.nextExpiry_) {
+        return;
+    }
+    shard.nextExpiry_ = now + expiryInterval_;
+    for(auto& [_, book] : shard.books_) {
+        book.ExpireOrders(now);
+    }
+}
+
+bool ShardedEngine::DrainOnce(Shard& shard)
+{
+    InstrumentId instrumentId = 0;
+    std::uint64_t trades = 0;
+    auto publish = [&](const Trade& trade) {
+        shard.trades_.Push(InstrumentTrade{instrumentId, trade});
+        ++trades;
+    };
+    TradeSink sink{publish};
+
+    std::uint64_t processed = 0, rejected = 0;
+    RoutedCommand routed;
+    for(auto& ring : shard.ingress_) {
+        for(std::size_t i = 0; i < DrainBatch && ring->TryPop(routed); ++i) {
+            ++processed;
+            auto it = shard.books_.find(routed.instrumentId_);
+            if(it == shard.books_.end()) {
+                ++rejected;
+                continue;
+            }
+            instrumentId = routed.instrumentId_;
+            it->second.Apply(routed.command_, sink);
+        }
+    }
+
+    //one relaxed add per pass rather than per command keeps the counters off the hot path
+    if(processed) {
+        shard.commandsProcessed_.fetch_add(processed, std::memory_order_relaxed);
+        shard.tradesPublished_.fetch_add(trades, std::memory_order_relaxed);
+        shard.commandsRejected_.fetch_add(rejected, std::memory_order_relaxed);
+    }
+    return processed != 0;
+}
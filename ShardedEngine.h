@@ -0,0 +1,102 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+#include "Orderbook.h"
+#include "OrderCommand.h"
+#include "SpscRing.h"
+#include "Clock.h"
+
+// a trade tagged with the book it happened in
+struct InstrumentTrade
+{
+    InstrumentId instrumentId_;
+    Trade trade_;
+};
+
+// per-shard throughput counters; safe to read from any thread while the engine runs
+struct ShardStats
+{
+    std::size_t books_;
+    std::uint64_t commandsProcessed_;
+    std::uint64_t tradesPublished_;
+    std::uint64_t commandsRejected_;
+};
+
+// many books, one per instrument, spread over a fixed pool of worker threads
+// an instrument always lives on shard (id % shardCount) and only that shard's thread ever touches its book,
+// so books need no locks and shards share nothing but the rings between them and the producers
+// producers get one SPSC ring per shard, so any producer can route to any instrument without contending
+class ShardedEngine
+{
+public:
+    ShardedEngine(std::size_t shardCount, std::size_t producerCount, std::size_t ringCapacity);
+    ~ShardedEngine();
+
+    ShardedEngine(const ShardedEngine &) = delete;
+    ShardedEngine &operator=(const ShardedEngine &) = delete;
+
+    // register every instrument before Start; the book tables are read-only once threads are running
+    void AddInstrument(InstrumentId instrumentId, LadderBand band = {}, std::size_t orderCapacity = 0);
+
+    // set before Start; each shard checks its books for expired orders on this clock once per expiryInterval
+    void SetClock(Clock clock, Timestamp expiryInterval = 1'000'000)
+    {
+        clock_ = std::move(clock);
+        expiryInterval_ = expiryInterval;
+    }
+
+    // shard i is pinned to firstCpu + i; firstCpu < 0 leaves them unpinned
+    void Start(int firstCpu = -1);
+    void Stop();
+
+    std::size_t ShardCount() const { return shards_.size(); }
+    std::size_t ShardOf(InstrumentId instrumentId) const { return instrumentId % shards_.size(); }
+
+    // called from producer thread `producer` only; spins if that shard's ring is full
+    void Submit(std::size_t producer, InstrumentId instrumentId, const OrderCommand &command);
+
+    // one consumer per shard must keep draining these
+    SpscRing<InstrumentTrade> &Outbound(std::size_t shard) { return shards_[shard]->trades_; }
+
+    ShardStats GetShardStats(std::size_t shard) const;
+
+    // only safe while stopped, except for GetTopOfBook, which any thread may poll while the shards run
+    Orderbook *Book(InstrumentId instrumentId);
+    const Orderbook *Book(InstrumentId instrumentId) const;
+
+private:
+    struct RoutedCommand
+    {
+        InstrumentId instrumentId_;
+        OrderCommand command_;
+    };
+
+    struct Shard
+    {
+        Shard(std::size_t producerCount, std::size_t ringCapacity);
+
+        std::vector<std::unique_ptr<SpscRing<RoutedCommand>>> ingress_;
+        SpscRing<InstrumentTrade> trades_;
+        std::unordered_map<InstrumentId, Orderbook> books_;
+        std::thread thread_;
+        Timestamp nextExpiry_{0};
+        alignas(Constants::CacheLineSize) std::atomic<std::uint64_t> commandsProcessed_{0};
+        std::atomic<std::uint64_t> tradesPublished_{0};
+        std::atomic<std::uint64_t> commandsRejected_{0};
+    };
+
+    void Run(Shard &shard);
+    bool DrainOnce(Shard &shard);
+    void ExpireOrders(Shard &shard);
+
+    std::vector<std::unique_ptr<Shard>> shards_;
+    Clock clock_{SystemClockNow};
+    Timestamp expiryInterval_{1'000'000};
+    std::atomic<bool> stop_{false};
+};
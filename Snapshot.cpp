@@ -0,0 +1,182 @@
+#include "Snapshot.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "Replay.h"
+
+namespace
+{
+    constexpr char SnapshotMagic[8] = {'O', 'B', 'S', 'N', 'A', 'P', '\0', '\0'};
+    // 4: the header carries the self-match policy and the reference price
+    constexpr std::uint32_t SnapshotVersion = 4;
+
+    bool WriteAll(int fd, const void* data, std::size_t size)
+    {
+        const char* bytes = static_cast<const char*>(data);
+        while(size > 0) {
+            ssize_t written = ::write(fd, bytes, size);
+            if(written < 0) {
+                if(errno == EINTR) {
+                    continue;
+                }
+                return false;
+            }
+            bytes += written;
+            size -= static_cast<std::size_t>(written);
+        }
+        return true;
+    }
+
+    // plain syscalls and a stack buffer only: this also runs in a forked child, where another thread may have
+    // been holding the allocator's lock at the moment of the fork
+    bool WriteSnapshotFile(const Orderbook& book, std::uint64_t journalSequence, const char* tmpPath, const char* path)
+    {
+        int fd = ::open(tmpPath, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if(fd < 0) {
+            return false;
+        }
+
+        SnapshotHeader header{};
+        std::memcpy(header.magic_, SnapshotMagic, sizeof(header.magic_));
+        header.version_ = SnapshotVersion;
+        header.recordSize_ = sizeof(SnapshotRecord);
+        header.journalSequence_ = journalSequence;
+        header.sessionEnd_ = book.GetSessionEnd();
+        header.orderCount_ = book.Size();
+        header.phase_ = static_cast<std::uint8_t>(book.GetPhase());
+        header.selfMatchPolicy_ = static_cast<std::uint8_t>(book.GetSelfMatchPolicy());
+        if(auto referencePrice = book.GetReferencePrice()) {
+            header.hasReferencePrice_ = 1;
+            header.referencePrice_ = *referencePrice;
+        }
+        bool ok = WriteAll(fd, &header, sizeof(header));
+
+        SnapshotRecord buffer[2048];
+        std::size_t buffered = 0;
+        book.ForEachOrder([&](const Order& order, Timestamp expiry) {
+            buffer[buffered++] = SnapshotRecord{
+                order.GetOrderId(),
+                expiry,
+                order.GetPrice(),
+                order.GetInitialQuantity(),
+                order.GetRemainingQuantity(),
+                order.GetDisplayQuantity(),
+                order.GetPeakQuantity(),
+                order.GetOwnerId(),
+                static_cast<std::uint8_t>(order.GetOrderType()),
+                static_cast<std::uint8_t>(order.GetSide()),
+                {},
+                order.GetStopPrice(),
+            };
+            if(buffered == std::size(buffer)) {
+                ok = ok && WriteAll(fd, buffer, sizeof(buffer));
+                buffered = 0;
+            }
+        });
+        ok = ok && WriteAll(fd, buffer, buffered * sizeof(SnapshotRecord));
+        ok = ok && ::fsync(fd) == 0;
+        ok = ::close(fd) == 0 && ok;
+        return ok && ::rename(tmpPath, path) == 0;
+    }
+}
+
+void WriteSnapshot(const Orderbook& book, std::uint64_t journalSequence, const std::string& path)
+{
+    std::string tmpPath = path + ".tmp";
+    if(!WriteSnapshotFile(book, journalSequence, tmpPath.c_str(), path.c_str())) {
+        throw std::runtime_error("cannot write snapshot: " + path);
+    }
+}
+
+pid_t ForkSnapshot(const Orderbook& book, std::uint64_t journalSequence, const std::string& path)
+{
+    //build the strings before forking; the child must not allocate
+    std::string tmpPath = path + ".tmp";
+    pid_t pid = ::fork();
+    if(pid == 0) {
+        bool ok = WriteSnapshotFile(book, journalSequence, tmpPath.c_str(), path.c_str());
+        ::_exit(ok ? 0 : 1);
+    }
+    return pid;
+}
+
+std::uint64_t LoadSnapshot(Orderbook& book, const std::string& path)
+{
+    std::FILE* file = std::fopen(path.c_str(), "rb");
+    if(!file) {
+        throw std::runtime_error("cannot open snapshot: " + path);
+    }
+
+    SnapshotHeader header{};
+    if(std::fread(&header, sizeof(header), 1, file) != 1 || std::memcmp(header.magic_, SnapshotMagic, sizeof(header.magic_)) != 0
+        || header.version_ != SnapshotVersion || header.recordSize_ != sizeof(SnapshotRecord)) {
+        std::fclose(file);
+        throw std::runtime_error("not a snapshot (or a different version): " + path);
+    }
+
+    book.SetSessionEnd(header.sessionEnd_);
+    book.SetSelfMatchPolicy(static_cast<SelfMatchPolicy>(header.selfMatchPolicy_));
+    if(header.hasReferencePrice_) {
+        book.SetReferencePrice(header.referencePrice_);
+    }
+
+    std::vector<SnapshotRecord> chunk(4096);
+    std::uint64_t remaining = header.orderCount_;
+    while(remaining > 0) {
+        std::size_t wanted = static_cast<std::size_t>(std::min<std::uint64_t>(remaining, chunk.size()));
+        if(std::fread(chunk.data(), sizeof(SnapshotRecord), wanted, file) != wanted) {
+            std::fclose(file);
+            throw std::runtime_error("snapshot is truncated: " + path);
+        }
+        for(std::size_t i = 0; i < wanted; ++i) {
+            const auto& record = chunk[i];
+            Order order{static_cast<OrderType>(record.orderType_), record.orderId_, static_cast<Side>(record.side_), record.price_, record.initialQuantity_, record.ownerId_,
+                record.peakQuantity_, record.stopPrice_};
+            order.Fill(record.initialQuantity_ - record.remainingQuantity_);
+            //an iceberg comes back mid-peak, exactly as it was showing
+            if(order.GetOrderType() == OrderType::Iceberg) {
+                order.SetDisplayQuantity(record.displayQuantity_);
+            }
+            book.RestoreOrder(order, record.expiry_);
+        }
+        remaining -= wanted;
+    }
+    std::fclose(file);
+
+    switch(static_cast<TradingPhase>(header.phase_)) {
+        case TradingPhase::Auction:
+            book.OpenAuction();
+            break;
+        case TradingPhase::Closed:
+            book.CloseBook();
+            break;
+        case TradingPhase::Continuous:
+            break;
+    }
+    return header.journalSequence_;
+}
+
+RecoveryResult Recover(Orderbook& book, const std::string& snapshotPath, const std::string& journalPath)
+{
+    RecoveryResult result{0, 0};
+    if(::access(snapshotPath.c_str(), F_OK) == 0) {
+        result.snapshotSequence_ = LoadSnapshot(book, snapshotPath);
+    }
+
+    if(::access(journalPath.c_str(), F_OK) == 0) {
+        EventLogReader journal{journalPath};
+        auto records = journal.Records();
+        if(result.snapshotSequence_ < records.size()) {
+            result.journalReplayed_ = Replay(records.subspan(result.snapshotSequence_), book).events_;
+        }
+    }
+    return result;
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <type_traits>
+
+#include <sys/types.h>
+
+#include "Orderbook.h"
+
+// snapshot file: header, then every resting order in priority order (bids best first, then asks), then the pending
+// stops in the order they would trigger (buy stops, then sell stops)
+struct SnapshotHeader
+{
+    char magic_[8];
+    std::uint32_t version_;
+    std::uint32_t recordSize_;
+    // how many journal records the snapshot already contains; recovery replays the journal from here
+    std::uint64_t journalSequence_;
+    Timestamp sessionEnd_;
+    std::uint64_t orderCount_;
+    std::uint8_t phase_;
+    std::uint8_t selfMatchPolicy_;
+    std::uint8_t hasReferencePrice_;
+    std::uint8_t reserved_;
+    Price referencePrice_;
+};
+
+// remainingQuantity_ counts an iceberg's hidden reserve; displayQuantity_ is the part of it that shows
+struct SnapshotRecord
+{
+    OrderId orderId_;
+    Timestamp expiry_;
+    Price price_;
+    Quantity initialQuantity_;
+    Quantity remainingQuantity_;
+    Quantity displayQuantity_;
+    Quantity peakQuantity_;
+    OwnerId ownerId_;
+    std::uint8_t orderType_;
+    std::uint8_t side_;
+    std::uint8_t reserved_[2];
+    Price stopPrice_;
+};
+
+static_assert(sizeof(SnapshotHeader) == 48 && std::is_trivially_copyable_v<SnapshotHeader>);
+static_assert(sizeof(SnapshotRecord) == 48 && std::is_trivially_copyable_v<SnapshotRecord>);
+
+// writes to path + ".tmp", syncs and renames over path, so a crash never leaves a half-written snapshot behind
+// throws std::runtime_error on failure
+void WriteSnapshot(const Orderbook &book, std::uint64_t journalSequence, const std::string &path);
+
+// forks and writes the snapshot from the child's copy-on-write view of the book, so the caller keeps matching
+// while it is written. returns the child's pid (reap it with waitpid) or -1 if fork failed
+pid_t ForkSnapshot(const Orderbook &book, std::uint64_t journalSequence, const std::string &path);
+
+// loads into an empty book and returns the journal sequence the snapshot covers; throws on a bad file
+std::uint64_t LoadSnapshot(Orderbook &book, const std::string &path);
+
+struct RecoveryResult
+{
+    std::uint64_t snapshotSequence_;
+    std::uint64_t journalReplayed_;
+};
+
+// latest snapshot (if there is one) plus the journal records after it; either file may be missing
+// throws std::runtime_error on a bad snapshot or a corrupt journal record
+// the session end, phase, self-match policy and reference price come from the snapshot and from the journal's session
+// commands, so without a snapshot the caller sets up whatever the journal doesn't
+RecoveryResult Recover(Orderbook &book, const std::string &snapshotPath, const std::string &journalPath);
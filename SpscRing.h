@@ -0,0 +1,89 @@
+#pragma once
+
+#include <atomic>
+#include <vector>
+#include <bit>
+#include <cstddef>
+#include <algorithm>
+
+#include "Constants.h"
+
+// tell the core we're spinning so it can back off the pipeline / hand cycles to the sibling hyperthread
+inline void CpuRelax()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#endif
+}
+
+// bounded single-producer single-consumer ring
+// exactly one thread may push and exactly one thread may pop; no locks, no allocation after construction
+// each side caches the other side's index so the shared cache line is only read when the ring looks full/empty
+template<typename T>
+class SpscRing
+{
+public:
+    explicit SpscRing(std::size_t capacity)
+        : buffer_(std::bit_ceil(std::max<std::size_t>(capacity, 2))), mask_{buffer_.size() - 1}
+    {
+    }
+
+    SpscRing(const SpscRing &) = delete;
+    SpscRing &operator=(const SpscRing &) = delete;
+
+    std::size_t Capacity() const { return buffer_.size(); }
+
+    // producer side
+    bool TryPush(const T &value)
+    {
+        const std::size_t head = head_.load(std::memory_order_relaxed);
+        if (head - cachedTail_ == buffer_.size())
+        {
+            cachedTail_ = tail_.load(std::memory_order_acquire);
+            if (head - cachedTail_ == buffer_.size())
+                return false;
+        }
+        buffer_[head & mask_] = value;
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    void Push(const T &value)
+    {
+        while (!TryPush(value))
+            CpuRelax();
+    }
+
+    // consumer side
+    bool TryPop(T &value)
+    {
+        const std::size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail == cachedHead_)
+        {
+            cachedHead_ = head_.load(std::memory_order_acquire);
+            if (tail == cachedHead_)
+                return false;
+        }
+        value = buffer_[tail & mask_];
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // safe from either side, but only a snapshot
+    bool Empty() const
+    {
+        return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire);
+    }
+
+private:
+    alignas(Constants::CacheLineSize) std::atomic<std::size_t> head_{0};
+    std::size_t cachedTail_{0};
+
+    alignas(Constants::CacheLineSize) std::atomic<std::size_t> tail_{0};
+    std::size_t cachedHead_{0};
+
+    alignas(Constants::CacheLineSize) std::vector<T> buffer_;
+    std::size_t mask_;
+};
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <unordered_map>
+
+#include "Usings.h"
+#include "OrderIdMap.h"
+
+// OrderIdMap's interface over std::unordered_map, the node-based index the book started out with;
+// kept as a policy so the two layouts can be benchmarked side by side
+template<typename Value>
+class StdOrderIdMap
+{
+public:
+    explicit StdOrderIdMap(std::size_t capacity = 0)
+    {
+        Reserve(capacity);
+    }
+
+    void Reserve(std::size_t count) { map_.reserve(count); }
+    std::size_t Size() const { return map_.size(); }
+
+    Value *Find(OrderId orderId)
+    {
+        auto it = map_.find(orderId);
+        return it == map_.end() ? nullptr : &it->second;
+    }
+
+    const Value *Find(OrderId orderId) const
+    {
+        return const_cast<StdOrderIdMap *>(this)->Find(orderId);
+    }
+
+    bool Contains(OrderId orderId) const { return map_.contains(orderId); }
+
+    bool Insert(OrderId orderId, const Value &value)
+    {
+        std::size_t buckets = map_.bucket_count();
+        bool inserted = map_.emplace(orderId, value).second;
+        if (map_.bucket_count() != buckets && buckets != 0)
+            ++rehashCount_;
+        return inserted;
+    }
+
+    bool Erase(OrderId orderId) { return map_.erase(orderId) != 0; }
+
+    // probe length here is how many nodes share a bucket
+    OrderIdMapStats Stats() const
+    {
+        std::size_t maxProbe = 0, totalProbe = 0;
+        for (std::size_t bucket = 0; bucket < map_.bucket_count(); ++bucket)
+        {
+            std::size_t length = map_.bucket_size(bucket);
+            maxProbe = std::max(maxProbe, length);
+            // the k-th node in a bucket takes k steps to reach
+            totalProbe += length * (length + 1) / 2;
+        }
+        return OrderIdMapStats{
+            map_.size(),
+            map_.bucket_count(),
+            static_cast<double>(map_.load_factor()),
+            maxProbe,
+            map_.empty() ? 0.0 : static_cast<double>(totalProbe) / map_.size(),
+            rehashCount_,
+        };
+    }
+
+private:
+    std::unordered_map<OrderId, Value> map_;
+    std::size_t rehashCount_{0};
+};
@@ -0,0 +1,22 @@
+#pragma once
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+// pin the calling thread to one core; a no-op (returning false) where the platform has no affinity API
+inline bool PinCurrentThread(int cpu)
+{
+#if defined(__linux__)
+    if (cpu < 0)
+        return false;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    (void)cpu;
+    return false;
+#endif
+}
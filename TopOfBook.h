@@ -0,0 +1,86 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#include "Constants.h"
+#include "SpscRing.h"
+#include "Usings.h"
+
+// best level on each side; a side with count 0 is empty and its price and quantity mean nothing
+struct TopOfBook
+{
+    Price bidPrice_{0};
+    Quantity bidQuantity_{0};
+    std::uint32_t bidCount_{0};
+    Price askPrice_{0};
+    Quantity askQuantity_{0};
+    std::uint32_t askCount_{0};
+    // bumped by every publish that changed something, so readers can tell a new top from the one they already saw
+    std::uint64_t sequence_{0};
+
+    bool HasBid() const { return bidCount_ != 0; }
+    bool HasAsk() const { return askCount_ != 0; }
+    bool SameLevels(const TopOfBook &other) const
+    {
+        return bidPrice_ == other.bidPrice_ && bidQuantity_ == other.bidQuantity_ && bidCount_ == other.bidCount_ &&
+               askPrice_ == other.askPrice_ && askQuantity_ == other.askQuantity_ && askCount_ == other.askCount_;
+    }
+};
+
+// seqlock: one writer (the thread running the book), any number of readers on other cores, and nobody ever blocks
+// the writer makes the version odd, stores, and makes it even again; a reader retries if it saw an odd version or the
+// version moved under it. the payload words are release-stored and acquire-loaded, so a reader that sees any new word
+// also sees the odd version ahead of it. on x86 those are plain moves, and unlike standalone fences tsan follows them
+// the whole cell is one cache line that only the writer dirties
+class alignas(Constants::CacheLineSize) TopOfBookCell
+{
+public:
+    void Publish(const TopOfBook &top)
+    {
+        std::uint64_t version = version_.load(std::memory_order_relaxed);
+        version_.store(version + 1, std::memory_order_relaxed);
+        bid_.store(Pack(top.bidPrice_, top.bidQuantity_), std::memory_order_release);
+        ask_.store(Pack(top.askPrice_, top.askQuantity_), std::memory_order_release);
+        counts_.store(Pack(static_cast<Price>(top.bidCount_), top.askCount_), std::memory_order_release);
+        sequence_.store(top.sequence_, std::memory_order_release);
+        version_.store(version + 2, std::memory_order_release);
+    }
+
+    TopOfBook Read() const
+    {
+        while (true)
+        {
+            std::uint64_t before = version_.load(std::memory_order_acquire);
+            if (before & 1)
+            {
+                CpuRelax();
+                continue;
+            }
+            std::uint64_t bid = bid_.load(std::memory_order_acquire);
+            std::uint64_t ask = ask_.load(std::memory_order_acquire);
+            std::uint64_t counts = counts_.load(std::memory_order_acquire);
+            std::uint64_t sequence = sequence_.load(std::memory_order_acquire);
+            if (version_.load(std::memory_order_relaxed) != before)
+                continue;
+
+            return TopOfBook{
+                static_cast<Price>(bid & 0xffffffffu), static_cast<Quantity>(bid >> 32), static_cast<std::uint32_t>(counts & 0xffffffffu),
+                static_cast<Price>(ask & 0xffffffffu), static_cast<Quantity>(ask >> 32), static_cast<std::uint32_t>(counts >> 32),
+                sequence,
+            };
+        }
+    }
+
+private:
+    static std::uint64_t Pack(Price low, std::uint32_t high)
+    {
+        return static_cast<std::uint32_t>(low) | (std::uint64_t{high} << 32);
+    }
+
+    std::atomic<std::uint64_t> version_{0};
+    std::atomic<std::uint64_t> bid_{0};
+    std::atomic<std::uint64_t> ask_{0};
+    std::atomic<std::uint64_t> counts_{0};
+    std::atomic<std::uint64_t> sequence_{0};
+};
@@ -5,6 +5,7 @@
 class Trade
 {
 public:
+    Trade() = default;
     Trade(const TradeInfo &bidTrade, const TradeInfo &askTrade)
     {
         bidTrade_ = bidTrade;
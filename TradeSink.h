@@ -0,0 +1,24 @@
+#pragma once
+
+#include <type_traits>
+
+#include "Trade.h"
+
+// non-owning reference to anything callable with a Trade; matching hands each trade to it as it happens
+// two pointers, no type erasure on the heap, so passing one down the hot path never allocates
+class TradeSink
+{
+public:
+    template<typename Fn>
+        requires(!std::is_same_v<std::remove_cvref_t<Fn>, TradeSink>)
+    TradeSink(Fn &fn)
+        : context_{&fn}, emit_{[](void *context, const Trade &trade) { (*static_cast<Fn *>(context))(trade); }}
+    {
+    }
+
+    void operator()(const Trade &trade) const { emit_(context_, trade); }
+
+private:
+    void *context_;
+    void (*emit_)(void *, const Trade &);
+};
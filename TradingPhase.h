@@ -0,0 +1,11 @@
+#pragma once
+
+// Continuous: every add is matched straight away
+// Auction: adds rest without matching (the book may cross) until Uncross
+// Closed: no new orders or modifies, cancels still allowed
+enum class TradingPhase
+{
+    Continuous,
+    Auction,
+    Closed,
+};
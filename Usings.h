@@ -5,4 +5,9 @@
 using Price = std::int32_t;
 using Quantity = std::uint32_t;
 using OrderId = std::uint64_t;
-using OrderIds = std::vector<OrderId>;
\ No newline at end of file
+using OrderIds = std::vector<OrderId>;
+using InstrumentId = std::uint32_t;
+// participant an order belongs to, for self-match prevention
+using OwnerId = std::uint32_t;
+// nanoseconds since the epoch
+using Timestamp = std::int64_t;
\ No newline at end of file
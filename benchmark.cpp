@@ -0,0 +1,674 @@
+#include "Orderbook.h"
+#include "Journal.h"
+#include "Snapshot.h"
+#include "MatchingThread.h"
+#include "ShardedEngine.h"
+#include "LatencyReport.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+#include <algorithm>
+#include <string>
+#include <thread>
+
+// microbenchmarks for the book's hot paths plus a generated session workload
+// every result is one csv row on stdout: benchmark,param,samples,ops_per_s,p50_ns,p90_ns,p99_ns,p999_ns,max_ns
+// built with -DORDERBOOK_METRICS, each workload run is followed by the book's own metrics as metrics_* rows: histograms
+// give their count and percentiles in ns (fills_per_aggressor in fills), counters their value in the samples column
+// usage: benchmark [--filter=prefix] [--events=N] [--rate=R] [--cancel-ratio=R] [--modify-ratio=R]
+//                  [--marketable-ratio=R] [--sigma=S] [--seed=S]
+namespace
+{
+    using BenchClock = std::chrono::steady_clock;
+
+    // shape of the generated session; every field can be overridden from the command line
+    struct WorkloadConfig
+    {
+        std::size_t events_{1'000'000};
+        // mean commands per second; gaps between arrivals are exponential (poisson arrivals)
+        double arrivalRate_{1'000'000.0};
+        double cancelRatio_{0.40};
+        double modifyRatio_{0.05};
+        // adds priced through the touch, so they trade on arrival
+        double marketableRatio_{0.05};
+        // passive adds land |N(0, sigma)| ticks behind the touch
+        double priceSigma_{5.0};
+        std::uint64_t seed_{42};
+        std::string filter_;
+    };
+
+    double NanosecondsSince(BenchClock::time_point start)
+    {
+        return std::chrono::duration<double, std::nano>(BenchClock::now() - start).count();
+    }
+
+#if defined(ORDERBOOK_METRICS)
+    void ReportMetrics(const OrderbookMetrics& metrics, const char* param)
+    {
+        static const double cyclesPerNanosecond = CyclesPerNanosecond();
+        auto histogram = [param](const char* name, const Histogram& histogram, double scale) {
+            std::printf("%s,%s,%llu,0,%.0f,%.0f,%.0f,%.0f,%.0f\n", name, param, static_cast<unsigned long long>(histogram.Count()),
+                histogram.Percentile(0.50) / scale, histogram.Percentile(0.90) / scale, histogram.Percentile(0.99) / scale,
+                histogram.Percentile(0.999) / scale, histogram.Max() / scale);
+        };
+        auto counter = [param](const char* name, const MetricCounter& counter) {
+            std::printf("%s,%s,%llu,0,0,0,0,0,0\n", name, param, static_cast<unsigned long long>(counter.Load()));
+        };
+        histogram("metrics_add", metrics.add_, cyclesPerNanosecond);
+        histogram("metrics_cancel", metrics.cancel_, cyclesPerNanosecond);
+        histogram("metrics_modify", metrics.modify_, cyclesPerNanosecond);
+        histogram("metrics_match", metrics.match_, cyclesPerNanosecond);
+        histogram("metrics_fills_per_aggressor", metrics.fillsPerAggressor_, 1.0);
+        counter("metrics_levels_created", metrics.levelsCreated_);
+        counter("metrics_levels_destroyed", metrics.levelsDestroyed_);
+        counter("metrics_max_sweep_depth", metrics.maxSweepDepth_);
+        counter("metrics_self_matches", metrics.selfMatches_);
+    }
+#endif
+
+    double Sum(const std::vector<double>& samples)
+    {
+        double total = 0;
+        for(double sample : samples) {
+            total += sample;
+        }
+        return total;
+    }
+
+    std::size_t tradeCount = 0;
+    auto countTrade = [](const Trade&) { ++tradeCount; };
+    TradeSink CountingSink() { return TradeSink{countTrade}; }
+
+    constexpr Price Mid = 100000;
+    const LadderBand Band{Mid - 20000, 1, 40001};
+
+    // owners of the resting orders FillBook spreads them across when asked to; aggressors use one outside the range
+    constexpr OwnerId RestingOwners = 64;
+
+    // `depth` levels per side, `perLevel` orders each, one tick apart and not crossing
+    // with `owned`, the orders cycle through owners 1..RestingOwners instead of having none; a nonzero `peak` makes
+    // them icebergs showing that much at a time
+    OrderId FillBook(Orderbook& book, std::size_t depth, std::size_t perLevel, OrderId orderId = 1, bool owned = false, Quantity peak = 0)
+    {
+        auto owner = [owned](OrderId id) { return owned ? static_cast<OwnerId>(id % RestingOwners + 1) : Constants::NoOwner; };
+        const OrderType type = peak ? OrderType::Iceberg : OrderType::GoodTillCancel;
+        for(std::size_t level = 0; level < depth; ++level) {
+            for(std::size_t i = 0; i < perLevel; ++i) {
+                book.AddOrder(Order{type, orderId, Side::Buy, Mid - 1 - static_cast<Price>(level), 10, owner(orderId), peak});
+                ++orderId;
+                book.AddOrder(Order{type, orderId, Side::Sell, Mid + 1 + static_cast<Price>(level), 10, owner(orderId), peak});
+                ++orderId;
+            }
+        }
+        return orderId;
+    }
+
+    // resting adds inside an existing book; each round of adds is cancelled again (untimed) so the depth stays put
+    void BenchAddPassive(std::size_t depth, std::mt19937_64& rng)
+    {
+        Orderbook book{Band, depth * 8 + 4096};
+        OrderId orderId = FillBook(book, depth, 4);
+        std::uniform_int_distribution<Price> offset{1, static_cast<Price>(depth)};
+
+        std::vector<double> samples;
+        std::vector<OrderId> added;
+        double wall = 0;
+        for(int round = 0; round < 200; ++round) {
+            added.clear();
+            auto roundStart = BenchClock::now();
+            for(int i = 0; i < 1000; ++i) {
+                Side side = i % 2 ? Side::Buy : Side::Sell;
+                Price price = side == Side::Buy ? Mid - offset(rng) : Mid + offset(rng);
+                Order order{OrderType::GoodTillCancel, orderId, side, price, 10};
+                auto start = BenchClock::now();
+                book.AddOrder(order, CountingSink());
+                samples.push_back(NanosecondsSince(start));
+                added.push_back(orderId++);
+            }
+            wall += NanosecondsSince(roundStart);
+            book.CancelOrders(added);
+        }
+        Report("add_passive", std::to_string(depth), samples, wall);
+    }
+
+    // aggressive adds that each take one lot from an ask level that never runs dry
+    void BenchAddCrossing(std::mt19937_64&)
+    {
+        Orderbook book{Band, 1 << 20};
+        OrderId orderId = FillBook(book, 100, 4);
+        book.AddOrder(Order{OrderType::GoodTillCancel, orderId++, Side::Sell, Mid, 1u << 31});
+
+        std::vector<double> samples;
+        auto wallStart = BenchClock::now();
+        for(int i = 0; i < 200000; ++i) {
+            Order order{OrderType::GoodTillCancel, orderId++, Side::Buy, Mid, 1};
+            auto start = BenchClock::now();
+            book.AddOrder(order, CountingSink());
+            samples.push_back(NanosecondsSince(start));
+        }
+        Report("add_crossing", "1", samples, NanosecondsSince(wallStart));
+    }
+
+    // cancels at a fixed queue position in one level of `levelSize` orders; the level is topped up again untimed
+    void BenchCancel(const char* name, double position, std::size_t levelSize)
+    {
+        Orderbook book{Band, levelSize + 4096};
+        OrderId orderId = FillBook(book, 100, 4);
+        const Price price = Mid - 200;
+        std::vector<OrderId> queue;
+        for(std::size_t i = 0; i < levelSize; ++i) {
+            book.AddOrder(Order{OrderType::GoodTillCancel, orderId, Side::Buy, price, 10});
+            queue.push_back(orderId++);
+        }
+
+        std::vector<double> samples;
+        double wall = 0;
+        for(int i = 0; i < 100000; ++i) {
+            std::size_t index = std::min(queue.size() - 1, static_cast<std::size_t>(position * queue.size()));
+            auto start = BenchClock::now();
+            book.CancelOrder(queue[index]);
+            double elapsed = NanosecondsSince(start);
+            samples.push_back(elapsed);
+            wall += elapsed;
+
+            queue.erase(queue.begin() + static_cast<std::ptrdiff_t>(index));
+            book.AddOrder(Order{OrderType::GoodTillCancel, orderId, Side::Buy, price, 10});
+            queue.push_back(orderId++);
+        }
+        Report(name, std::to_string(levelSize), samples, wall);
+    }
+
+    // moves random resting orders to another passive price on the same side
+    void BenchModify(std::size_t depth, std::mt19937_64& rng)
+    {
+        Orderbook book{Band, depth * 8 + 4096};
+        OrderId lastId = FillBook(book, depth, 4);
+        std::uniform_int_distribution<OrderId> pick{1, lastId - 1};
+        std::uniform_int_distribution<Price> offset{1, static_cast<Price>(depth)};
+
+        std::vector<double> samples;
+        auto wallStart = BenchClock::now();
+        for(int i = 0; i < 200000; ++i) {
+            //FillBook alternates buy (odd ids) and sell (even ids)
+            OrderId orderId = pick(rng);
+            Side side = orderId % 2 ? Side::Buy : Side::Sell;
+            Price price = side == Side::Buy ? Mid - offset(rng) : Mid + offset(rng);
+            auto start = BenchClock::now();
+            book.ModifyOrder(OrderModify{orderId, side, price, 10}, CountingSink());
+            samples.push_back(NanosecondsSince(start));
+        }
+        Report("modify", std::to_string(depth), samples, NanosecondsSince(wallStart));
+    }
+
+    // one aggressor that clears `levels` ask levels of 4 orders each; the book is rebuilt untimed between samples
+    // sweep is a limit order priced through the last level, sweep_market a market order for the same quantity
+    // sweep_owned gives every order an owner (none of them the aggressor's), so each fill pays the full self-match
+    // compare without ever taking it; compare it against sweep for the check's cost
+    // sweep_iceberg makes every resting order an iceberg showing half of itself, so each one fills, goes round to the
+    // back of its level with its second half and fills again: twice sweep's fills for the same quantity, which is what
+    // to divide by when comparing the two
+    void BenchSweep(const char* name, std::size_t levels, OrderType type, bool owned, Quantity peak = 0)
+    {
+        std::vector<double> samples;
+        double wall = 0;
+        for(int i = 0; i < 500; ++i) {
+            Orderbook book{Band, levels * 8 + 16};
+            OrderId orderId = FillBook(book, levels, 4, 1, owned, peak);
+            OwnerId owner = owned ? RestingOwners + 1 : Constants::NoOwner;
+            Order sweep{type, orderId, Side::Buy, Mid + static_cast<Price>(levels), static_cast<Quantity>(levels * 4 * 10), owner};
+            auto start = BenchClock::now();
+            book.AddOrder(sweep, CountingSink());
+            double elapsed = NanosecondsSince(start);
+            samples.push_back(elapsed);
+            wall += elapsed;
+        }
+        Report(name, std::to_string(levels), samples, wall);
+    }
+
+    // one lot lifting the best ask, with `triggered` buy stop-limits waiting at that price and PendingStops sell stops
+    // far below it that the print never reaches; the stop-limits come in passive, behind the bids, so the row is the
+    // cost of triggering and activating them. at 0 it shows that the waiting stops cost nothing
+    void BenchStopTrigger(std::size_t triggered)
+    {
+        constexpr std::size_t PendingStops = 10000;
+        std::vector<double> samples;
+        double wall = 0;
+        for(int i = 0; i < 200; ++i) {
+            Orderbook book{Band, 100 * 8 + PendingStops + triggered + 16};
+            OrderId orderId = FillBook(book, 100, 4);
+            for(std::size_t s = 0; s < PendingStops; ++s) {
+                book.AddOrder(Order{OrderType::Stop, orderId++, Side::Sell, 0, 10, Constants::NoOwner, 0, Mid - 1000 - static_cast<Price>(s % 500)});
+            }
+            for(std::size_t s = 0; s < triggered; ++s) {
+                book.AddOrder(Order{OrderType::StopLimit, orderId++, Side::Buy, Mid - 50, 10, Constants::NoOwner, 0, Mid + 1});
+            }
+            Order lift{OrderType::GoodTillCancel, orderId, Side::Buy, Mid + 1, 1};
+            auto start = BenchClock::now();
+            book.AddOrder(lift, CountingSink());
+            double elapsed = NanosecondsSince(start);
+            samples.push_back(elapsed);
+            wall += elapsed;
+        }
+        Report("stop_trigger", std::to_string(triggered), samples, wall);
+    }
+
+    // full-depth copy (allocates) against the top-10 span overload (doesn't) and the seqlocked top of book
+    void BenchOrderInfos(std::size_t depth)
+    {
+        Orderbook book{Band, depth * 8};
+        FillBook(book, depth, 4);
+        const int iterations = depth >= 10000 ? 2000 : 20000;
+
+        std::vector<double> samples;
+        auto wallStart = BenchClock::now();
+        for(int i = 0; i < iterations; ++i) {
+            auto start = BenchClock::now();
+            auto infos = book.GetOrderInfos();
+            samples.push_back(NanosecondsSince(start));
+            tradeCount += infos.GetBids().size();
+        }
+        Report("order_infos_full", std::to_string(depth), samples, NanosecondsSince(wallStart));
+
+        LevelInfo bids[10], asks[10];
+        samples.clear();
+        wallStart = BenchClock::now();
+        for(int i = 0; i < iterations; ++i) {
+            auto start = BenchClock::now();
+            auto counts = book.GetOrderInfos(bids, asks);
+            samples.push_back(NanosecondsSince(start));
+            tradeCount += counts.bids_;
+        }
+        Report("order_infos_top10", std::to_string(depth), samples, NanosecondsSince(wallStart));
+
+        samples.clear();
+        wallStart = BenchClock::now();
+        for(int i = 0; i < iterations; ++i) {
+            auto start = BenchClock::now();
+            TopOfBook top = book.GetTopOfBook();
+            samples.push_back(NanosecondsSince(start));
+            tradeCount += top.bidCount_;
+        }
+        Report("order_infos_top_of_book", std::to_string(depth), samples, NanosecondsSince(wallStart));
+    }
+
+    struct TimedCommand
+    {
+        Timestamp arrival_;
+        OrderCommand command_;
+    };
+
+    // a session around a slowly drifting mid: passive adds behind the touch, some marketable adds, cancels and
+    // modifies of live orders, arrivals a poisson process at the configured rate
+    std::vector<TimedCommand> GenerateWorkload(const WorkloadConfig& config)
+    {
+        std::mt19937_64 rng{config.seed_};
+        std::exponential_distribution<double> gap{config.arrivalRate_ / 1e9};
+        std::normal_distribution<double> behind{0.0, config.priceSigma_};
+        std::uniform_real_distribution<double> roll{0.0, 1.0};
+        std::uniform_int_distribution<Quantity> quantity{1, 200};
+
+        std::vector<TimedCommand> commands;
+        commands.reserve(config.events_);
+        std::vector<OrderId> live;
+        OrderId nextId = 1;
+        double now = 0;
+        Price mid = Mid;
+
+        for(std::size_t i = 0; i < config.events_; ++i) {
+            now += gap(rng);
+            if(rng() % 1000 == 0) {
+                mid += rng() % 2 ? 1 : -1;
+            }
+
+            OrderCommand command{};
+            double r = roll(rng);
+            if(r < config.cancelRatio_ && !live.empty()) {
+                std::size_t index = rng() % live.size();
+                command.type_ = CommandType::Cancel;
+                command.orderId_ = live[index];
+                live[index] = live.back();
+                live.pop_back();
+            }
+            else if(r < config.cancelRatio_ + config.modifyRatio_ && !live.empty()) {
+                command.type_ = CommandType::Modify;
+                command.orderId_ = live[rng() % live.size()];
+                command.side_ = rng() % 2 ? Side::Buy : Side::Sell;
+                Price ticks = 1 + static_cast<Price>(std::fabs(behind(rng)));
+                command.price_ = command.side_ == Side::Buy ? mid - ticks : mid + ticks;
+                command.quantity_ = quantity(rng);
+            }
+            else {
+                command.type_ = CommandType::Add;
+                command.orderType_ = OrderType::GoodTillCancel;
+                command.orderId_ = nextId++;
+                command.side_ = rng() % 2 ? Side::Buy : Side::Sell;
+                bool marketable = roll(rng) < config.marketableRatio_;
+                Price ticks = marketable ? -1 - static_cast<Price>(rng() % 3) : 1 + static_cast<Price>(std::fabs(behind(rng)));
+                command.price_ = command.side_ == Side::Buy ? mid - ticks : mid + ticks;
+                command.quantity_ = quantity(rng);
+                live.push_back(command.orderId_);
+            }
+            commands.push_back(TimedCommand{static_cast<Timestamp>(now), command});
+        }
+        return commands;
+    }
+
+    // service time is what Apply itself took; response time also counts queueing behind earlier commands when
+    // they arrive faster than the book keeps up (open-loop, so a slow command can't hide the ones stuck behind it)
+    // withFeed also attaches a market-by-price consumer, to show what incremental publishing costs per command;
+    // running it per Policy puts the book layouts side by side on the same session
+    template<typename Policy>
+    void BenchWorkload(const WorkloadConfig& config, bool withFeed, const char* policyName)
+    {
+        auto commands = GenerateWorkload(config);
+        BasicOrderbook<Policy> book{Band, config.events_};
+        std::size_t levelUpdates = 0;
+        auto consume = [&levelUpdates](const MarketDataMessage& message) { levelUpdates += message.updates_.size(); };
+        if(withFeed) {
+            book.SetMarketDataSink(MarketDataSink{consume});
+        }
+
+        std::vector<double> service;
+        service.reserve(commands.size());
+        auto wallStart = BenchClock::now();
+        for(const auto& timed : commands) {
+            auto start = BenchClock::now();
+            book.Apply(timed.command_, CountingSink());
+            service.push_back(NanosecondsSince(start));
+        }
+        double wall = NanosecondsSince(wallStart);
+
+        std::vector<double> response;
+        response.reserve(commands.size());
+        double finish = 0;
+        for(std::size_t i = 0; i < commands.size(); ++i) {
+            double arrival = static_cast<double>(commands[i].arrival_);
+            finish = std::max(finish, arrival) + service[i];
+            response.push_back(finish - arrival);
+        }
+
+        char param[128];
+        std::snprintf(param, sizeof(param), "policy=%s;rate=%.0f;cancel=%.2f;modify=%.2f;marketable=%.2f;sigma=%.1f",
+            policyName, config.arrivalRate_, config.cancelRatio_, config.modifyRatio_, config.marketableRatio_, config.priceSigma_);
+        Report(withFeed ? "workload_service_mbp" : "workload_service", param, service, wall);
+        Report(withFeed ? "workload_response_mbp" : "workload_response", param, response, wall);
+#if defined(ORDERBOOK_METRICS)
+        ReportMetrics(book.GetMetrics(), param);
+#endif
+    }
+
+    // builds a crossed auction book `depth` levels deep on each side and times one Uncross
+    double TimeUncross(std::size_t depth, std::size_t ordersPerLevel, std::mt19937_64& rng)
+    {
+        Orderbook book{LadderBand{Mid - static_cast<Price>(depth), 1, depth * 2 + 1}, depth * ordersPerLevel * 2};
+        book.OpenAuction();
+
+        OrderId orderId = 1;
+        std::uniform_int_distribution<Quantity> quantity{1, 100};
+        for(std::size_t level = 0; level < depth; ++level) {
+            //bids from mid + depth/2 downwards and asks from mid - depth/2 upwards, so half of each side crosses
+            Price bidPrice = Mid + static_cast<Price>(depth / 2) - static_cast<Price>(level);
+            Price askPrice = Mid - static_cast<Price>(depth / 2) + static_cast<Price>(level);
+            for(std::size_t i = 0; i < ordersPerLevel; ++i) {
+                book.AddOrder(Order{OrderType::GoodTillCancel, orderId++, Side::Buy, bidPrice, quantity(rng)});
+                book.AddOrder(Order{OrderType::GoodTillCancel, orderId++, Side::Sell, askPrice, quantity(rng)});
+            }
+        }
+
+        auto start = BenchClock::now();
+        book.Uncross(CountingSink());
+        return NanosecondsSince(start);
+    }
+
+    void BenchUncross(std::size_t depth, std::mt19937_64& rng)
+    {
+        std::vector<double> samples;
+        for(int i = 0; i < 21; ++i) {
+            samples.push_back(TimeUncross(depth, 4, rng));
+        }
+        Report("uncross", std::to_string(depth), samples, Sum(samples));
+    }
+
+    // journals a session that leaves `orders` resting (each next to an order that was added and cancelled again),
+    // snapshots the book, then times both ways of getting it back after a restart
+    void BenchRestart(std::size_t orders, std::mt19937_64& rng)
+    {
+        const std::string journalPath = "restart_bench.journal";
+        const std::string snapshotPath = "restart_bench.snap";
+        std::remove(journalPath.c_str());
+        std::remove(snapshotPath.c_str());
+
+        const LadderBand band{90000, 1, 20001};
+        std::uniform_int_distribution<Price> offset{1, 10000};
+        std::uniform_int_distribution<Quantity> quantity{1, 100};
+        {
+            Orderbook book{band, orders};
+            Journal journal{journalPath, 65536};
+            TradeSink sink = CountingSink();
+            Timestamp now = 0;
+            auto apply = [&](const OrderCommand& command) {
+                journal.Append(now++, command);
+                book.Apply(command, sink);
+            };
+            for(std::size_t i = 0; i < orders; ++i) {
+                //bids below 100000 and asks above it, so nothing trades
+                Side side = i % 2 ? Side::Buy : Side::Sell;
+                Price price = side == Side::Buy ? 100000 - offset(rng) : 100000 + offset(rng);
+                OrderId orderId = static_cast<OrderId>(i * 2 + 1);
+                apply(OrderCommand{CommandType::Add, OrderType::GoodTillCancel, side, orderId, price, quantity(rng)});
+                apply(OrderCommand{CommandType::Add, OrderType::GoodTillCancel, side, orderId + 1, price, quantity(rng)});
+                apply(OrderCommand{CommandType::Cancel, OrderType::GoodTillCancel, side, orderId + 1, price, 0});
+            }
+            journal.Commit();
+            WriteSnapshot(book, journal.Sequence(), snapshotPath);
+        }
+
+        auto start = BenchClock::now();
+        Orderbook fromSnapshot{band, orders};
+        Recover(fromSnapshot, snapshotPath, journalPath);
+        std::vector<double> samples{NanosecondsSince(start)};
+        Report("restart_snapshot", std::to_string(orders), samples, samples[0]);
+
+        start = BenchClock::now();
+        Orderbook fromJournal{band, orders};
+        Recover(fromJournal, "", journalPath);
+        samples = {NanosecondsSince(start)};
+        Report("restart_journal", std::to_string(orders), samples, samples[0]);
+
+        std::remove(journalPath.c_str());
+        std::remove(snapshotPath.c_str());
+    }
+
+    // `producers` gateway threads feeding one MatchingThread, each command a one-lot buy against a sell that never runs
+    // dry, so every command comes back as exactly one trade. a sample is push to trade popped off the outbound ring,
+    // so it counts queueing behind the other gateways as well as the match itself
+    void BenchMatchingThread(std::size_t producers)
+    {
+        constexpr std::size_t PerProducer = 50000;
+        const OrderId firstId = 2;
+        MatchingThread matcher{producers, 4096, Band, 16};
+        matcher.Book().AddOrder(Order{OrderType::GoodTillCancel, 1, Side::Sell, Mid, 1u << 31});
+
+        //written by each producer before its push and read after the trade comes back, so the rings order them
+        std::vector<BenchClock::time_point> pushed(producers * PerProducer);
+        std::vector<double> samples;
+        samples.reserve(pushed.size());
+        matcher.Start();
+
+        auto wallStart = BenchClock::now();
+        std::vector<std::thread> gateways;
+        for(std::size_t p = 0; p < producers; ++p) {
+            gateways.emplace_back([&, p] {
+                auto& ring = matcher.Ingress(p);
+                for(std::size_t i = 0; i < PerProducer; ++i) {
+                    std::size_t index = p * PerProducer + i;
+                    pushed[index] = BenchClock::now();
+                    ring.Push(OrderCommand{CommandType::Add, OrderType::GoodTillCancel, Side::Buy, firstId + index, Mid, 1});
+                }
+            });
+        }
+
+        Trade trade;
+        while(samples.size() < pushed.size()) {
+            if(matcher.Outbound().TryPop(trade)) {
+                samples.push_back(NanosecondsSince(pushed[trade.GetBidTrade().orderId_ - firstId]));
+            }
+            else {
+                CpuRelax();
+            }
+        }
+        double wall = NanosecondsSince(wallStart);
+        for(auto& gateway : gateways) {
+            gateway.join();
+        }
+        matcher.Stop();
+        Report("matching_thread", std::to_string(producers), samples, wall);
+    }
+
+    // one gateway spreading one-lot buys round robin over `symbols` books on `shards` shard threads, every book with a
+    // sell that never runs dry; rounds of 1000 commands are submitted and then all their trades collected, and a sample
+    // is submit to trade popped. with shards on separate cores the rows show how far the per-symbol load spreads
+    void BenchShardedEngine(std::size_t shards, std::size_t symbols)
+    {
+        constexpr std::size_t Rounds = 100;
+        constexpr std::size_t PerRound = 1000;
+        ShardedEngine engine{shards, 1, PerRound};
+        for(InstrumentId symbol = 0; symbol < symbols; ++symbol) {
+            engine.AddInstrument(symbol, LadderBand{Mid - 10, 1, 21}, 16);
+            engine.Book(symbol)->AddOrder(Order{OrderType::GoodTillCancel, 0, Side::Sell, Mid, 1u << 31});
+        }
+
+        std::vector<BenchClock::time_point> submitted(PerRound);
+        std::vector<double> samples;
+        samples.reserve(Rounds * PerRound);
+        engine.Start();
+
+        OrderId orderId = 1;
+        InstrumentTrade trade;
+        double wall = 0;
+        for(std::size_t round = 0; round < Rounds; ++round) {
+            auto roundStart = BenchClock::now();
+            for(std::size_t i = 0; i < PerRound; ++i) {
+                submitted[i] = BenchClock::now();
+                engine.Submit(0, static_cast<InstrumentId>(orderId % symbols),
+                    OrderCommand{CommandType::Add, OrderType::GoodTillCancel, Side::Buy, orderId, Mid, 1});
+                ++orderId;
+            }
+            for(std::size_t collected = 0; collected < PerRound;) {
+                for(std::size_t shard = 0; shard < shards; ++shard) {
+                    while(engine.Outbound(shard).TryPop(trade)) {
+                        samples.push_back(NanosecondsSince(submitted[(trade.trade_.GetBidTrade().orderId_ - 1) % PerRound]));
+                        ++collected;
+                    }
+                }
+                CpuRelax();
+            }
+            wall += NanosecondsSince(roundStart);
+        }
+        engine.Stop();
+        Report("sharded", "shards=" + std::to_string(shards) + ";symbols=" + std::to_string(symbols), samples, wall);
+    }
+
+    WorkloadConfig ParseArguments(int argc, char** argv)
+    {
+        WorkloadConfig config;
+        for(int i = 1; i < argc; ++i) {
+            const char* argument = argv[i];
+            const char* value = std::strchr(argument, '=');
+            if(!value) {
+                std::fprintf(stderr, "ignoring %s (expected --name=value)\n", argument);
+                continue;
+            }
+            std::string name{argument, value++};
+            if(name == "--filter") config.filter_ = value;
+            else if(name == "--events") config.events_ = std::strtoull(value, nullptr, 10);
+            else if(name == "--rate") config.arrivalRate_ = std::strtod(value, nullptr);
+            else if(name == "--cancel-ratio") config.cancelRatio_ = std::strtod(value, nullptr);
+            else if(name == "--modify-ratio") config.modifyRatio_ = std::strtod(value, nullptr);
+            else if(name == "--marketable-ratio") config.marketableRatio_ = std::strtod(value, nullptr);
+            else if(name == "--sigma") config.priceSigma_ = std::strtod(value, nullptr);
+            else if(name == "--seed") config.seed_ = std::strtoull(value, nullptr, 10);
+            else std::fprintf(stderr, "unknown option %s\n", name.c_str());
+        }
+        return config;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    WorkloadConfig config = ParseArguments(argc, argv);
+    std::mt19937_64 rng{config.seed_};
+    auto selected = [&config](const char* group) { return std::strncmp(group, config.filter_.c_str(), config.filter_.size()) == 0; };
+
+    PrintReportHeader();
+    if(selected("add")) {
+        for(std::size_t depth : {10, 1000}) {
+            BenchAddPassive(depth, rng);
+        }
+        BenchAddCrossing(rng);
+    }
+    if(selected("cancel")) {
+        for(std::size_t levelSize : {10, 1000}) {
+            BenchCancel("cancel_front", 0.0, levelSize);
+            BenchCancel("cancel_middle", 0.5, levelSize);
+            BenchCancel("cancel_back", 1.0, levelSize);
+        }
+    }
+    if(selected("modify")) {
+        for(std::size_t depth : {10, 1000}) {
+            BenchModify(depth, rng);
+        }
+    }
+    if(selected("sweep")) {
+        for(std::size_t levels : {1, 10, 100, 1000}) {
+            BenchSweep("sweep", levels, OrderType::GoodTillCancel, false);
+            BenchSweep("sweep_owned", levels, OrderType::GoodTillCancel, true);
+            BenchSweep("sweep_market", levels, OrderType::Market, false);
+            BenchSweep("sweep_iceberg", levels, OrderType::GoodTillCancel, false, 5);
+        }
+    }
+    if(selected("stop")) {
+        for(std::size_t triggered : {0, 1, 100, 10000}) {
+            BenchStopTrigger(triggered);
+        }
+    }
+    if(selected("matching_thread")) {
+        for(std::size_t producers : {1, 2, 4}) {
+            BenchMatchingThread(producers);
+        }
+    }
+    if(selected("sharded")) {
+        for(std::size_t shards : {1, 2, 4}) {
+            for(std::size_t symbols : {4, 256}) {
+                BenchShardedEngine(shards, symbols);
+            }
+        }
+    }
+    if(selected("order_infos")) {
+        for(std::size_t depth : {10, 100, 1000, 10000}) {
+            BenchOrderInfos(depth);
+        }
+    }
+    if(selected("workload")) {
+        BenchWorkload<DefaultOrderbookPolicy>(config, false, "default");
+        BenchWorkload<DefaultOrderbookPolicy>(config, true, "default");
+        BenchWorkload<LockedOrderbookPolicy>(config, false, "locked");
+        BenchWorkload<StdIndexOrderbookPolicy>(config, false, "std_index");
+    }
+    if(selected("uncross")) {
+        for(std::size_t depth : {10, 100, 1000, 10000}) {
+            BenchUncross(depth, rng);
+        }
+    }
+    if(selected("restart")) {
+        for(std::size_t orders : {10'000, 100'000, 1'000'000}) {
+            BenchRestart(orders, rng);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,307 @@
+#include "OrderEntryServer.h"
+#include "LatencyReport.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// order entry over a Unix domain socket, end to end on one box
+//   orderentry serve <socket>                 book + OrderEntryServer, one client after another
+//   orderentry load <socket> [options]        load generator against a running server
+//   orderentry run [options]                  forks a server on a temporary socket and loads it
+// options: --events=N --window=N (commands in flight; 1 is ping-pong) --marketable-ratio=R --seed=S
+// results are csv rows in benchmark's format; latency runs from just before a command's write to the read that
+// returns its Accepted. wire_ack covers every command, wire_trade only those that traded (their executions precede
+// the Accepted, so that is wire to trade)
+namespace
+{
+    using LoadClock = std::chrono::steady_clock;
+
+    constexpr Price Mid = 10'000;
+    // covers the generator's price range with room to drift, as replay's default does
+    const LadderBand Band{9'000, 1, 2'000};
+
+    struct LoadConfig
+    {
+        std::size_t events_{200'000};
+        std::size_t window_{1};
+        double marketableRatio_{0.05};
+        std::uint64_t seed_{42};
+    };
+
+    struct Outstanding
+    {
+        OrderId orderId_;
+        LoadClock::time_point sent_;
+    };
+
+    int Connect(const std::string& path)
+    {
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        if(path.size() >= sizeof(address.sun_path)) {
+            throw std::runtime_error("socket path too long: " + path);
+        }
+        std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+        int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        //the server may still be starting up
+        for(int attempt = 0; fd >= 0 && attempt < 200; ++attempt) {
+            if(::connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == 0) {
+                return fd;
+            }
+            ::usleep(10'000);
+        }
+        if(fd >= 0) {
+            ::close(fd);
+        }
+        throw std::runtime_error("cannot connect to " + path + ": " + std::strerror(errno));
+    }
+
+    // a session around a drifting mid: passive adds, some marketable ones, cancels and replaces of live orders
+    class CommandGenerator
+    {
+    public:
+        CommandGenerator(const LoadConfig& config) : config_{config}, rng_{config.seed_} {}
+
+        OrderCommand Next()
+        {
+            if(rng_() % 1000 == 0) {
+                mid_ += rng_() % 2 ? 1 : -1;
+            }
+            OrderCommand command{};
+            unsigned roll = rng_() % 100;
+            if(roll < 30 && !live_.empty()) {
+                std::size_t pick = rng_() % live_.size();
+                command.type_ = CommandType::Cancel;
+                command.orderId_ = live_[pick];
+                live_[pick] = live_.back();
+                live_.pop_back();
+                return command;
+            }
+            command.side_ = rng_() % 2 ? Side::Buy : Side::Sell;
+            command.quantity_ = quantity_(rng_);
+            if(roll < 38 && !live_.empty()) {
+                command.type_ = CommandType::Modify;
+                command.orderId_ = live_[rng_() % live_.size()];
+                command.price_ = PassivePrice(command.side_);
+                return command;
+            }
+            command.type_ = CommandType::Add;
+            command.orderType_ = OrderType::GoodTillCancel;
+            command.orderId_ = nextId_++;
+            bool marketable = std::uniform_real_distribution<double>{0.0, 1.0}(rng_) < config_.marketableRatio_;
+            //through the touch by a few ticks, so it takes whatever rests near the mid
+            command.price_ = marketable ? mid_ + (command.side_ == Side::Buy ? 5 : -5) : PassivePrice(command.side_);
+            live_.push_back(command.orderId_);
+            return command;
+        }
+
+    private:
+        Price PassivePrice(Side side)
+        {
+            Price behind = 1 + static_cast<Price>(std::abs(offset_(rng_)));
+            return side == Side::Buy ? mid_ - behind : mid_ + behind;
+        }
+
+        const LoadConfig& config_;
+        std::mt19937_64 rng_;
+        std::normal_distribution<double> offset_{0.0, 5.0};
+        std::uniform_int_distribution<Quantity> quantity_{1, 200};
+        std::vector<OrderId> live_;
+        OrderId nextId_{1};
+        Price mid_{Mid};
+    };
+
+    int Serve(const std::string& path)
+    {
+        Orderbook book{Band, 1 << 20};
+        OrderEntryServer server{book, path};
+        while(true) {
+            std::uint64_t commands = server.ServeClient();
+            std::fprintf(stderr, "orderentry: client done after %llu commands, %zu orders resting\n",
+                static_cast<unsigned long long>(commands), book.Size());
+        }
+    }
+
+    int Load(const std::string& path, const LoadConfig& config)
+    {
+        int fd = Connect(path);
+        CommandGenerator generator{config};
+        std::vector<std::byte> sendBuffer(config.window_ * MaxCommandMessageSize);
+        std::vector<std::byte> receive(64 * 1024);
+        std::size_t pending = 0;
+        std::deque<Outstanding> inFlight;
+        std::vector<double> ackSamples;
+        std::vector<double> tradeSamples;
+        ackSamples.reserve(config.events_);
+        std::size_t sent = 0;
+        std::size_t executions = 0;
+        bool traded = false;
+
+        auto wallStart = LoadClock::now();
+        while(sent < config.events_ || !inFlight.empty()) {
+            //top the window up in one write
+            std::size_t bytes = 0;
+            auto now = LoadClock::now();
+            while(sent < config.events_ && inFlight.size() < config.window_) {
+                OrderCommand command = generator.Next();
+                bytes += EncodeCommand(command, sendBuffer.data() + bytes);
+                inFlight.push_back(Outstanding{command.orderId_, now});
+                ++sent;
+            }
+            for(std::size_t written = 0; written < bytes;) {
+                ssize_t result = ::write(fd, sendBuffer.data() + written, bytes - written);
+                if(result < 0) {
+                    throw std::runtime_error(std::string{"write failed: "} + std::strerror(errno));
+                }
+                written += static_cast<std::size_t>(result);
+            }
+
+            ssize_t received = ::read(fd, receive.data() + pending, receive.size() - pending);
+            if(received <= 0) {
+                throw std::runtime_error("server closed the connection");
+            }
+            auto arrived = LoadClock::now();
+            pending += static_cast<std::size_t>(received);
+
+            std::size_t offset = 0;
+            while(pending - offset >= sizeof(WireHeader)) {
+                auto header = LoadWireMessage<WireHeader>(receive.data() + offset);
+                if(pending - offset < header.length_) {
+                    break;
+                }
+                if(header.type_ == ExecutedMessage::Type) {
+                    ++executions;
+                    traded = true;
+                }
+                else if(header.type_ == AcceptedMessage::Type) {
+                    //answers come back in command order
+                    double latency = std::chrono::duration<double, std::nano>(arrived - inFlight.front().sent_).count();
+                    ackSamples.push_back(latency);
+                    if(traded) {
+                        tradeSamples.push_back(latency);
+                    }
+                    traded = false;
+                    inFlight.pop_front();
+                }
+                else {
+                    throw std::runtime_error("unexpected message from server");
+                }
+                offset += header.length_;
+            }
+            std::memmove(receive.data(), receive.data() + offset, pending - offset);
+            pending -= offset;
+        }
+        double wall = std::chrono::duration<double, std::nano>(LoadClock::now() - wallStart).count();
+        ::close(fd);
+
+        std::string param = "window=" + std::to_string(config.window_);
+        PrintReportHeader();
+        Report("wire_ack", param, ackSamples, wall);
+        Report("wire_trade", param, tradeSamples, wall);
+        std::fprintf(stderr, "orderentry: %zu commands, %zu executions\n", sent, executions);
+        return 0;
+    }
+
+    int Run(const LoadConfig& config)
+    {
+        std::string path = "/tmp/orderentry." + std::to_string(::getpid()) + ".sock";
+        pid_t child = ::fork();
+        if(child < 0) {
+            throw std::runtime_error("fork failed");
+        }
+        if(child == 0) {
+            try {
+                Serve(path);
+            }
+            catch(const std::exception& e) {
+                std::fprintf(stderr, "orderentry server: %s\n", e.what());
+            }
+            ::_exit(1);
+        }
+
+        int result = 1;
+        try {
+            result = Load(path, config);
+        }
+        catch(...) {
+            ::kill(child, SIGTERM);
+            ::waitpid(child, nullptr, 0);
+            ::unlink(path.c_str());
+            throw;
+        }
+        ::kill(child, SIGTERM);
+        ::waitpid(child, nullptr, 0);
+        ::unlink(path.c_str());
+        return result;
+    }
+
+    LoadConfig ParseOptions(int argc, char** argv, int first)
+    {
+        LoadConfig config;
+        for(int i = first; i < argc; ++i) {
+            const char* argument = argv[i];
+            const char* value = std::strchr(argument, '=');
+            if(!value) {
+                std::fprintf(stderr, "ignoring %s (expected --name=value)\n", argument);
+                continue;
+            }
+            std::string name{argument, value++};
+            if(name == "--events") config.events_ = std::strtoull(value, nullptr, 10);
+            else if(name == "--window") config.window_ = std::max<std::size_t>(1, std::strtoull(value, nullptr, 10));
+            else if(name == "--marketable-ratio") config.marketableRatio_ = std::strtod(value, nullptr);
+            else if(name == "--seed") config.seed_ = std::strtoull(value, nullptr, 10);
+            else std::fprintf(stderr, "unknown option %s\n", name.c_str());
+        }
+        return config;
+    }
+
+    int Usage()
+    {
+        std::fprintf(stderr,
+            "usage: orderentry serve <socket>\n"
+            "       orderentry load <socket> [--events=N] [--window=N] [--marketable-ratio=R] [--seed=S]\n"
+            "       orderentry run [--events=N] [--window=N] [--marketable-ratio=R] [--seed=S]\n");
+        return 2;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if(argc < 2) {
+        return Usage();
+    }
+
+    std::string mode = argv[1];
+    try {
+        if(mode == "serve" && argc == 3) {
+            return Serve(argv[2]);
+        }
+        if(mode == "load" && argc >= 3) {
+            return Load(argv[2], ParseOptions(argc, argv, 3));
+        }
+        if(mode == "run") {
+            return Run(ParseOptions(argc, argv, 2));
+        }
+    }
+    catch(const std::exception& e) {
+        std::fprintf(stderr, "orderentry: %s\n", e.what());
+        return 1;
+    }
+    return Usage();
+}
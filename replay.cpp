@@ -0,0 +1,66 @@
+#include "Replay.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+namespace
+{
+    int Run(const std::string& path, LadderBand band)
+    {
+        EventLogReader reader{path};
+        auto events = reader.Records();
+        Orderbook book{band, events.size() / 4};
+
+        auto start = std::chrono::steady_clock::now();
+        ReplayResult result = Replay(events, book);
+        auto end = std::chrono::steady_clock::now();
+        double seconds = std::chrono::duration<double>(end - start).count();
+
+        std::printf("events=%llu\n", static_cast<unsigned long long>(result.events_));
+        std::printf("seconds=%.6f\n", seconds);
+        std::printf("events_per_second=%.0f\n", seconds > 0 ? result.events_ / seconds : 0.0);
+        std::printf("trades=%llu\n", static_cast<unsigned long long>(result.trades_));
+        std::printf("trade_hash=%016llx\n", static_cast<unsigned long long>(result.tradeHash_));
+        std::printf("book_hash=%016llx\n", static_cast<unsigned long long>(result.bookHash_));
+        std::printf("resting_orders=%zu\n", book.Size());
+        return 0;
+    }
+
+    int Usage()
+    {
+        std::fprintf(stderr,
+            "usage: replay generate <log> <events> [seed]\n"
+            "       replay run <log> [basePrice tickSize levelCount]\n");
+        return 2;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if(argc < 3) {
+        return Usage();
+    }
+
+    std::string mode = argv[1];
+    try {
+        if(mode == "generate" && argc >= 4) {
+            GenerateEventLog(argv[2], std::strtoull(argv[3], nullptr, 10), argc >= 5 ? std::strtoull(argv[4], nullptr, 10) : 1);
+            return 0;
+        }
+        if(mode == "run") {
+            //default band covers the generator's price range with room to drift
+            LadderBand band{9'000, 1, 2'000};
+            if(argc >= 6) {
+                band = LadderBand{static_cast<Price>(std::atoi(argv[3])), static_cast<Price>(std::atoi(argv[4])), std::strtoull(argv[5], nullptr, 10)};
+            }
+            return Run(argv[2], band);
+        }
+    }
+    catch(const std::exception& e) {
+        std::fprintf(stderr, "replay: %s\n", e.what());
+        return 1;
+    }
+    return Usage();
+}
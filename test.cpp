@@ -1,4 +1,10 @@
 #include "Orderbook.h"
+#include "OrderEntry.h"
+#include "MatchingThread.h"
+#include "ShardedEngine.h"
+#include "Replay.h"
+#include "Journal.h"
+#include "Snapshot.h"
 #include <iostream>
 #include <map>
 #include <set>
@@ -22,6 +28,979 @@
 #include <format>
 
 #include <iostream>
+#include <random>
+#include <thread>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+// brute force: add up every level on the other side at or better than the limit
+bool BruteForceCanFullyFill(const OrderbookLevelInfos& infos, Side side, Price price, Quantity quantity)
+{
+    std::uint64_t available = 0;
+    for(const auto& level : side == Side::Buy ? infos.GetAsks() : infos.GetBids()) {
+        if(side == Side::Buy ? level.price_ <= price : level.price_ >= price) {
+            available += level.quantity_;
+        }
+    }
+    return available >= quantity;
+}
+
+// random books (some prices inside the ladder band, some in the tree fallback), random FillOrKill probes;
+// a FOK must either trade its whole quantity or leave the book untouched, exactly when brute force says it can fill
+template<typename Policy>
+bool TestFillOrKill(Policy)
+{
+    std::mt19937 rng{7};
+    OrderId orderId = 1;
+    for(int round = 0; round < 500; ++round) {
+        BasicOrderbook<Policy> orderbook{LadderBand{90, 2, 8}};
+        for(int i = 0; i < 40; ++i) {
+            Side side = rng() % 2 ? Side::Buy : Side::Sell;
+            Price price = side == Side::Buy ? 80 + rng() % 20 : 100 + rng() % 20;
+            orderbook.AddOrder(Order{OrderType::GoodTillCancel, orderId++, side, price, 1 + static_cast<Quantity>(rng() % 10)});
+        }
+
+        Side side = rng() % 2 ? Side::Buy : Side::Sell;
+        Price price = 75 + rng() % 50;
+        Quantity quantity = 1 + rng() % 150;
+        bool expected = BruteForceCanFullyFill(orderbook.GetOrderInfos(), side, price, quantity);
+
+        std::size_t sizeBefore = orderbook.Size();
+        Quantity filled = 0;
+        for(const auto& trade : orderbook.AddOrder(Order{OrderType::FillOrKill, orderId++, side, price, quantity})) {
+            filled += trade.GetBidTrade().quantity_;
+        }
+
+        if(expected ? filled != quantity : (filled != 0 || orderbook.Size() != sizeBefore)) {
+            std::cout << "FillOrKill mismatch in round " << round << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+// drives GoodForDay expiry with made-up timestamps instead of waiting for 4pm
+template<typename Policy>
+bool TestGoodForDayExpiry(Policy)
+{
+    BasicOrderbook<Policy> orderbook{LadderBand{90, 1, 20}};
+    const Timestamp sessionEnd = 1'000;
+    orderbook.SetSessionEnd(sessionEnd);
+
+    OrderId orderId = 1;
+    for(Price price = 90; price < 95; ++price) {
+        orderbook.AddOrder(Order{OrderType::GoodForDay, orderId++, Side::Buy, price, 10});
+        orderbook.AddOrder(Order{OrderType::GoodTillCancel, orderId++, Side::Buy, price, 10});
+    }
+    //one GFD order partly filled, one cancelled before the close
+    orderbook.AddOrder(Order{OrderType::GoodTillCancel, orderId++, Side::Sell, 94, 5});
+    orderbook.CancelOrder(1);
+
+    if(orderbook.ExpireOrders(sessionEnd - 1) != 0 || orderbook.Size() != 9) {
+        std::cout << "GoodForDay orders expired early" << std::endl;
+        return false;
+    }
+    if(orderbook.ExpireOrders(sessionEnd) != 4 || orderbook.Size() != 5 || orderbook.ExpireOrders(sessionEnd + 1) != 0) {
+        std::cout << "GoodForDay orders did not expire at the session end" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// rebuilds both sides from the feed alone (first snapshot, then increments) while random commands hit the book;
+// after every command the rebuilt book has to match GetOrderInfos level for level, and GetTopOfBook its first levels
+template<typename Policy>
+bool TestMarketDataFeed(Policy)
+{
+    BasicOrderbook<Policy> orderbook{LadderBand{95, 1, 10}};
+    orderbook.SetSessionEnd(500);
+    std::map<Price, LevelInfo> levels[2];
+    std::uint64_t sequence = 0;
+    bool consistent = true;
+
+    auto consume = [&](const MarketDataMessage& message) {
+        if(message.snapshot_) {
+            levels[0].clear();
+            levels[1].clear();
+            sequence = message.sequence_;
+        }
+        for(const auto& update : message.updates_) {
+            auto& side = levels[update.side_ == Side::Buy ? 0 : 1];
+            bool known = side.count(update.price_) != 0;
+            if(!message.snapshot_ && (update.sequence_ != ++sequence || known == (update.action_ == LevelAction::New))) {
+                consistent = false;
+            }
+            if(update.action_ == LevelAction::Delete) {
+                side.erase(update.price_);
+            }
+            else {
+                side[update.price_] = LevelInfo{update.price_, update.quantity_, update.count_};
+            }
+        }
+    };
+    orderbook.SetMarketDataSink(MarketDataSink{consume}, 50);
+
+    auto matches = [&](const LevelInfos& infos, const std::map<Price, LevelInfo>& side) {
+        return infos.size() == side.size() && std::all_of(infos.begin(), infos.end(), [&](const LevelInfo& info) {
+            auto it = side.find(info.price_);
+            return it != side.end() && it->second.quantity_ == info.quantity_ && it->second.count_ == info.count_;
+        });
+    };
+
+    std::mt19937 rng{11};
+    const OrderType types[] = {OrderType::GoodTillCancel, OrderType::GoodForDay, OrderType::FillAndKill, OrderType::FillOrKill};
+    OrderId orderId = 1;
+    for(int i = 0; i < 5000; ++i) {
+        Side side = rng() % 2 ? Side::Buy : Side::Sell;
+        Price price = 90 + rng() % 20;
+        Quantity quantity = 1 + rng() % 20;
+        switch(rng() % 5) {
+            case 0:
+                orderbook.CancelOrder(1 + rng() % orderId);
+                break;
+            case 1:
+                orderbook.ModifyOrder(OrderModify{1 + rng() % orderId, side, price, quantity});
+                break;
+            case 2:
+                orderbook.ExpireOrders(i / 10);
+                break;
+            default:
+                orderbook.AddOrder(Order{types[rng() % 4], orderId++, side, price, quantity});
+                break;
+        }
+
+        auto infos = orderbook.GetOrderInfos();
+        if(!consistent || !matches(infos.GetBids(), levels[0]) || !matches(infos.GetAsks(), levels[1])) {
+            std::cout << "market data diverged from the book at command " << i << std::endl;
+            return false;
+        }
+
+        //the seqlocked top of book has to agree with the first level on each side
+        TopOfBook top = orderbook.GetTopOfBook();
+        auto sameTop = [](const LevelInfos& infos, bool present, Price price, Quantity quantity, std::uint32_t count) {
+            return infos.empty() ? !present : present && infos[0].price_ == price && infos[0].quantity_ == quantity && infos[0].count_ == count;
+        };
+        if(!sameTop(infos.GetBids(), top.HasBid(), top.bidPrice_, top.bidQuantity_, top.bidCount_)
+            || !sameTop(infos.GetAsks(), top.HasAsk(), top.askPrice_, top.askQuantity_, top.askCount_)) {
+            std::cout << "top of book diverged from the book at command " << i << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+// one writer publishes tops whose every field follows from the sequence while readers spin on Read: a torn read
+// (fields from two publishes) can't match the top its own sequence stands for, and no reader may see time go back
+bool TestTopOfBookCell()
+{
+    constexpr std::uint64_t Publishes = 2'000'000;
+    auto topFor = [](std::uint64_t sequence) {
+        auto s = static_cast<std::uint32_t>(sequence);
+        return TopOfBook{static_cast<Price>(s), s * 3, s % 7 + 1, static_cast<Price>(s + 1000), s * 5, s % 11 + 1, sequence};
+    };
+
+    TopOfBookCell cell;
+    std::atomic<bool> done{false};
+    std::atomic<bool> torn{false};
+    std::vector<std::thread> readers;
+    for(int reader = 0; reader < 2; ++reader) {
+        readers.emplace_back([&] {
+            std::uint64_t last = 0;
+            while(!done.load(std::memory_order_acquire)) {
+                TopOfBook top = cell.Read();
+                bool published = top.sequence_ == 0 ? top.SameLevels(TopOfBook{}) : top.SameLevels(topFor(top.sequence_));
+                if(!published || top.sequence_ < last) {
+                    torn.store(true, std::memory_order_relaxed);
+                }
+                last = top.sequence_;
+            }
+        });
+    }
+    for(std::uint64_t sequence = 1; sequence <= Publishes; ++sequence) {
+        cell.Publish(topFor(sequence));
+    }
+    done.store(true, std::memory_order_release);
+    for(auto& reader : readers) {
+        reader.join();
+    }
+
+    bool ok = !torn.load() && cell.Read().sequence_ == Publishes && cell.Read().SameLevels(topFor(Publishes));
+    if(!ok) {
+        std::cout << "top of book read a snapshot that was never published" << std::endl;
+    }
+    return ok;
+}
+
+// the span overload fills the same levels as the allocating one, best first, and stops at the span's end; levels
+// outside the band (on the tree fallback) come out in the same order
+template<typename Policy>
+bool TestDepthSpans(Policy)
+{
+    BasicOrderbook<Policy> orderbook{LadderBand{95, 1, 10}};
+    std::mt19937 rng{9};
+    for(OrderId orderId = 1; orderId <= 200; ++orderId) {
+        Side side = rng() % 2 ? Side::Buy : Side::Sell;
+        //bids below 100 and asks from 100 up, so nothing crosses and every level stays
+        Price price = side == Side::Buy ? 85 + rng() % 15 : 100 + rng() % 15;
+        orderbook.AddOrder(Order{OrderType::GoodTillCancel, orderId, side, price, 1 + static_cast<Quantity>(rng() % 20)});
+    }
+
+    auto infos = orderbook.GetOrderInfos();
+    auto same = [](std::span<const LevelInfo> filled, const LevelInfos& expected) {
+        for(std::size_t i = 0; i < filled.size(); ++i) {
+            if(filled[i].price_ != expected[i].price_ || filled[i].quantity_ != expected[i].quantity_ || filled[i].count_ != expected[i].count_) {
+                return false;
+            }
+        }
+        return true;
+    };
+    bool ok = infos.GetBids().size() > 10 && infos.GetAsks().size() > 10
+        && infos.GetBids().front().price_ > infos.GetBids().back().price_ && infos.GetAsks().front().price_ < infos.GetAsks().back().price_;
+    for(std::size_t depth : {std::size_t{0}, std::size_t{1}, std::size_t{5}, infos.GetBids().size(), std::size_t{40}}) {
+        std::vector<LevelInfo> bids(depth), asks(depth);
+        auto counts = orderbook.GetOrderInfos(bids, asks);
+        ok = ok && counts.bids_ == std::min(depth, infos.GetBids().size()) && counts.asks_ == std::min(depth, infos.GetAsks().size())
+            && same(std::span{bids}.first(counts.bids_), infos.GetBids()) && same(std::span{asks}.first(counts.asks_), infos.GetAsks());
+    }
+    if(!ok) {
+        std::cout << "depth spans disagree with the level infos" << std::endl;
+    }
+    return ok;
+}
+
+// a reduce-only modify keeps the order at the front of its level; growing it sends it to the back
+template<typename Policy>
+bool TestModifyPriority(Policy)
+{
+    BasicOrderbook<Policy> orderbook{LadderBand{95, 1, 10}};
+    orderbook.AddOrder(Order{OrderType::GoodTillCancel, 1, Side::Sell, 100, 10});
+    orderbook.AddOrder(Order{OrderType::GoodTillCancel, 2, Side::Sell, 100, 10});
+
+    orderbook.ModifyOrder(OrderModify{1, Side::Sell, 100, 4});
+    auto trades = orderbook.AddOrder(Order{OrderType::FillAndKill, 3, Side::Buy, 100, 2});
+    if(trades.size() != 1 || trades[0].GetAskTrade().orderId_ != 1 || orderbook.GetOrderInfos().GetAsks()[0].quantity_ != 12) {
+        std::cout << "reduced order lost its priority" << std::endl;
+        return false;
+    }
+
+    orderbook.ModifyOrder(OrderModify{1, Side::Sell, 100, 5});
+    trades = orderbook.AddOrder(Order{OrderType::FillAndKill, 4, Side::Buy, 100, 2});
+    if(trades.size() != 1 || trades[0].GetAskTrade().orderId_ != 2) {
+        std::cout << "increased order kept its priority" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// two orders from the same owner never trade, whichever self-match policy is set
+template<typename Policy>
+bool TestSelfMatch(Policy)
+{
+    const OwnerId owner = 7;
+    auto run = [&](SelfMatchPolicy policy, std::size_t expectedSize) {
+        BasicOrderbook<Policy> orderbook{LadderBand{95, 1, 10}};
+        orderbook.SetSelfMatchPolicy(policy);
+        orderbook.AddOrder(Order{OrderType::GoodTillCancel, 1, Side::Sell, 100, 10, owner});
+        orderbook.AddOrder(Order{OrderType::GoodTillCancel, 2, Side::Sell, 101, 10, owner + 1});
+        auto trades = orderbook.AddOrder(Order{OrderType::GoodTillCancel, 3, Side::Buy, 101, 4, owner});
+        //only CancelResting lets the aggressor reach the other owner's order
+        std::size_t expectedTrades = policy == SelfMatchPolicy::CancelResting ? 1 : 0;
+        if(trades.size() != expectedTrades || orderbook.Size() != expectedSize
+            || (expectedTrades && trades[0].GetAskTrade().orderId_ != 2)) {
+            std::cout << "self-match policy " << static_cast<int>(policy) << " misbehaved" << std::endl;
+            return false;
+        }
+        return true;
+    };
+    return run(SelfMatchPolicy::CancelResting, 1) && run(SelfMatchPolicy::CancelAggressor, 2) && run(SelfMatchPolicy::DecrementBoth, 2);
+}
+
+// a market order trades at each resting price and never rests, even when it outlasts the other side
+template<typename Policy>
+bool TestMarketOrder(Policy)
+{
+    BasicOrderbook<Policy> orderbook{LadderBand{95, 1, 10}};
+    orderbook.AddOrder(Order{OrderType::GoodTillCancel, 1, Side::Sell, 100, 5});
+    orderbook.AddOrder(Order{OrderType::GoodTillCancel, 2, Side::Sell, 101, 5});
+
+    auto trades = orderbook.AddOrder(Order{3, Side::Buy, 8});
+    bool ok = trades.size() == 2 && trades[0].GetBidTrade().price_ == 100 && trades[1].GetAskTrade().price_ == 101
+        && trades[1].GetBidTrade().quantity_ == 3 && orderbook.Size() == 1;
+    trades = orderbook.AddOrder(Order{4, Side::Buy, 10});
+    ok = ok && trades.size() == 1 && trades[0].GetAskTrade().quantity_ == 2 && orderbook.Size() == 0;
+    if(!ok) {
+        std::cout << "market order swept the book wrongly" << std::endl;
+    }
+    return ok;
+}
+
+// the uncross price maximises matched volume, then minimises the imbalance, then sits nearest the reference price;
+// the fills go in price-time priority at that one price, and only an auction can be uncrossed
+template<typename Policy>
+bool TestAuction(Policy)
+{
+    std::vector<Trade> trades;
+    auto collect = [&trades](const Trade& trade) { trades.push_back(trade); };
+
+    BasicOrderbook<Policy> orderbook{LadderBand{95, 1, 10}};
+    orderbook.OpenAuction();
+    orderbook.AddOrder(Order{OrderType::GoodTillCancel, 1, Side::Buy, 102, 5});
+    orderbook.AddOrder(Order{OrderType::GoodTillCancel, 2, Side::Buy, 101, 10});
+    orderbook.AddOrder(Order{OrderType::GoodTillCancel, 3, Side::Buy, 100, 10});
+    orderbook.AddOrder(Order{OrderType::GoodTillCancel, 4, Side::Sell, 99, 15});
+    orderbook.AddOrder(Order{OrderType::GoodTillCancel, 5, Side::Sell, 100, 10});
+    orderbook.AddOrder(Order{OrderType::GoodTillCancel, 6, Side::Sell, 101, 10});
+    orderbook.AddOrder(Order{OrderType::GoodTillCancel, 7, Side::Buy, 102, 5});
+
+    //volume by price: 102 -> 10, 101 -> 20, 100 -> 25, 99 -> 15
+    auto indicative = orderbook.GetIndicativeUncross();
+    bool ok = indicative.price_ == 100 && indicative.volume_ == 25 && indicative.imbalance_ == 5;
+
+    auto result = orderbook.Uncross(TradeSink{collect});
+    const OrderId expected[][2] = {{1, 4}, {7, 4}, {2, 4}, {2, 5}, {3, 5}};
+    ok = ok && result.volume_ == 25 && trades.size() == std::size(expected) && orderbook.GetPhase() == TradingPhase::Continuous;
+    for(std::size_t i = 0; ok && i < trades.size(); ++i) {
+        ok = trades[i].GetBidTrade().orderId_ == expected[i][0] && trades[i].GetAskTrade().orderId_ == expected[i][1]
+            && trades[i].GetBidTrade().price_ == 100 && trades[i].GetAskTrade().price_ == 100;
+    }
+    ok = ok && orderbook.Size() == 2;
+
+    //100 and 101 both match 10, but 101 leaves nobody over
+    BasicOrderbook<Policy> imbalanced{LadderBand{95, 1, 10}};
+    imbalanced.OpenAuction();
+    imbalanced.AddOrder(Order{OrderType::GoodTillCancel, 1, Side::Buy, 101, 10});
+    imbalanced.AddOrder(Order{OrderType::GoodTillCancel, 2, Side::Buy, 100, 5});
+    imbalanced.AddOrder(Order{OrderType::GoodTillCancel, 3, Side::Sell, 100, 10});
+    indicative = imbalanced.GetIndicativeUncross();
+    ok = ok && indicative.price_ == 101 && indicative.volume_ == 10 && indicative.imbalance_ == 0;
+
+    //100 and 101 tie on both, so the reference price decides, and the lower price without one
+    BasicOrderbook<Policy> tied{LadderBand{95, 1, 10}};
+    tied.OpenAuction();
+    tied.AddOrder(Order{OrderType::GoodTillCancel, 1, Side::Buy, 101, 10});
+    tied.AddOrder(Order{OrderType::GoodTillCancel, 2, Side::Sell, 100, 10});
+    ok = ok && tied.GetIndicativeUncross().price_ == 100;
+    tied.SetReferencePrice(105);
+    ok = ok && tied.GetIndicativeUncross().price_ == 101;
+    tied.SetReferencePrice(90);
+    ok = ok && tied.GetIndicativeUncross().price_ == 100;
+
+    //closed, the crossed book stays as it is
+    trades.clear();
+    tied.CloseBook();
+    result = tied.Uncross(TradeSink{collect});
+    ok = ok && result.volume_ == 0 && trades.empty() && tied.Size() == 2 && tied.GetPhase() == TradingPhase::Closed;
+    if(!ok) {
+        std::cout << "auction uncrossed wrongly" << std::endl;
+    }
+    return ok;
+}
+
+// a burst drops ids already in the book and repeats of its own ids, and queues the rest in span order; a batch cancel
+// skips ids it doesn't know or has already cancelled
+template<typename Policy>
+bool TestBatchEntry(Policy)
+{
+    BasicOrderbook<Policy> orderbook{LadderBand{95, 1, 10}};
+    orderbook.AddOrder(Order{OrderType::GoodTillCancel, 1, Side::Sell, 105, 5});
+    const OrderRequest requests[] = {
+        OrderRequest{OrderType::GoodTillCancel, 2, Side::Sell, 101, 5},
+        OrderRequest{OrderType::GoodTillCancel, 3, Side::Sell, 100, 5},
+        OrderRequest{OrderType::GoodTillCancel, 1, Side::Buy, 90, 5},
+        OrderRequest{OrderType::GoodTillCancel, 4, Side::Sell, 100, 5},
+        OrderRequest{OrderType::GoodTillCancel, 3, Side::Sell, 100, 7},
+        OrderRequest{OrderType::GoodTillCancel, 5, Side::Sell, 100, 5},
+    };
+    auto trades = orderbook.AddOrders(requests);
+    auto infos = orderbook.GetOrderInfos();
+    bool ok = trades.empty() && orderbook.Size() == 5 && infos.GetBids().empty() && infos.GetAsks().size() == 3
+        && infos.GetAsks()[0].quantity_ == 15 && infos.GetAsks()[0].count_ == 3;
+
+    trades = orderbook.AddOrder(Order{OrderType::FillAndKill, 6, Side::Buy, 100, 12});
+    ok = ok && trades.size() == 3 && trades[0].GetAskTrade().orderId_ == 3 && trades[1].GetAskTrade().orderId_ == 4
+        && trades[2].GetAskTrade().orderId_ == 5 && trades[2].GetAskTrade().quantity_ == 2;
+
+    const OrderId cancels[] = {5, 99, 2, 5, 42};
+    orderbook.CancelOrders(cancels);
+    infos = orderbook.GetOrderInfos();
+    ok = ok && orderbook.Size() == 1 && infos.GetAsks().size() == 1 && infos.GetAsks()[0].price_ == 105;
+    if(!ok) {
+        std::cout << "batch entry misbehaved" << std::endl;
+    }
+    return ok;
+}
+
+// stops in a burst during an auction wait for a print like stops entered one at a time
+template<typename Policy>
+bool TestBatchStopsInAuction(Policy)
+{
+    BasicOrderbook<Policy> orderbook{LadderBand{95, 1, 10}};
+    orderbook.OpenAuction();
+    const OrderRequest requests[] = {
+        OrderRequest{OrderType::GoodTillCancel, 1, Side::Sell, 100, 5},
+        OrderRequest{OrderType::StopLimit, 2, Side::Buy, 101, 5, Constants::NoOwner, 0, 100},
+    };
+    orderbook.AddOrders(requests);
+    bool ok = orderbook.Size() == 2 && orderbook.GetOrderInfos().GetBids().empty();
+
+    //the uncross prints at 100, which sets the stop-limit off into the continuous book
+    orderbook.AddOrder(Order{OrderType::GoodTillCancel, 3, Side::Buy, 100, 5});
+    Quantity uncrossed = 0;
+    auto count = [&uncrossed](const Trade& trade) { uncrossed += trade.GetBidTrade().quantity_; };
+    orderbook.Uncross(TradeSink{count});
+    auto bids = orderbook.GetOrderInfos().GetBids();
+    ok = ok && uncrossed == 5 && orderbook.Size() == 1 && bids.size() == 1 && bids[0].price_ == 101 && bids[0].quantity_ == 5;
+    if(!ok) {
+        std::cout << "stops in an auction burst were lost" << std::endl;
+    }
+    return ok;
+}
+
+// an iceberg shows only its peak; each filled peak is replaced from the reserve at the back of the level, and the
+// reserve still counts for FillOrKill and the auction uncross
+template<typename Policy>
+bool TestIceberg(Policy)
+{
+    BasicOrderbook<Policy> orderbook{LadderBand{95, 1, 10}};
+    orderbook.AddOrder(Order{OrderType::Iceberg, 1, Side::Sell, 100, 100, Constants::NoOwner, 10});
+    orderbook.AddOrder(Order{OrderType::GoodTillCancel, 2, Side::Sell, 100, 5});
+    bool ok = orderbook.GetOrderInfos().GetAsks()[0].quantity_ == 15;
+
+    auto trades = orderbook.AddOrder(Order{OrderType::GoodTillCancel, 3, Side::Buy, 100, 15});
+    ok = ok && trades.size() == 2 && trades[0].GetAskTrade().orderId_ == 1 && trades[0].GetAskTrade().quantity_ == 10
+        && trades[1].GetAskTrade().orderId_ == 2 && orderbook.Size() == 1 && orderbook.GetOrderInfos().GetAsks()[0].quantity_ == 10;
+
+    //down to 15 open: the hidden part goes first, so what shows stays put
+    orderbook.ModifyOrder(OrderModify{1, Side::Sell, 100, 15});
+    ok = ok && orderbook.GetOrderInfos().GetAsks()[0].quantity_ == 10;
+    trades = orderbook.AddOrder(Order{OrderType::FillOrKill, 4, Side::Buy, 100, 15});
+    ok = ok && trades.size() == 2 && orderbook.Size() == 0;
+
+    orderbook.OpenAuction();
+    orderbook.AddOrder(Order{OrderType::Iceberg, 5, Side::Sell, 100, 30, Constants::NoOwner, 5});
+    orderbook.AddOrder(Order{OrderType::GoodTillCancel, 6, Side::Buy, 100, 20});
+    Quantity uncrossed = 0;
+    auto count = [&uncrossed](const Trade& trade) { uncrossed += trade.GetBidTrade().quantity_; };
+    auto result = orderbook.Uncross(TradeSink{count});
+    ok = ok && result.volume_ == 20 && uncrossed == 20 && orderbook.GetOrderInfos().GetAsks()[0].quantity_ == 5;
+
+    if(!ok) {
+        std::cout << "iceberg replenished wrongly" << std::endl;
+    }
+    return ok;
+}
+
+// stops wait off the book until a print reaches them, then come in one after another in trigger order, each one's
+// trades able to set off the next
+template<typename Policy>
+bool TestStopOrders(Policy)
+{
+    BasicOrderbook<Policy> orderbook{LadderBand{95, 1, 10}};
+    orderbook.AddOrder(Order{OrderType::GoodTillCancel, 1, Side::Sell, 100, 5});
+    orderbook.AddOrder(Order{OrderType::GoodTillCancel, 2, Side::Sell, 101, 5});
+    orderbook.AddOrder(Order{OrderType::GoodTillCancel, 3, Side::Sell, 103, 10});
+    orderbook.AddOrder(Order{OrderType::GoodTillCancel, 4, Side::Buy, 95, 10});
+    orderbook.AddOrder(Order{OrderType::Stop, 10, Side::Buy, 0, 5, Constants::NoOwner, 0, 101});
+    orderbook.AddOrder(Order{OrderType::StopLimit, 11, Side::Buy, 103, 3, Constants::NoOwner, 0, 100});
+    orderbook.AddOrder(Order{OrderType::Stop, 12, Side::Sell, 0, 5, Constants::NoOwner, 0, 96});
+    bool ok = orderbook.Size() == 7 && orderbook.GetOrderInfos().GetBids().size() == 1;
+
+    //the print at 100 sets off 11, whose print at 101 sets off 10; the sell stop never sees a low enough print
+    auto trades = orderbook.AddOrder(Order{OrderType::GoodTillCancel, 13, Side::Buy, 100, 5});
+    ok = ok && trades.size() == 4
+        && trades[0].GetBidTrade().orderId_ == 13 && trades[0].GetAskTrade().orderId_ == 1
+        && trades[1].GetBidTrade().orderId_ == 11 && trades[1].GetAskTrade().price_ == 101 && trades[1].GetAskTrade().quantity_ == 3
+        && trades[2].GetBidTrade().orderId_ == 10 && trades[2].GetAskTrade().orderId_ == 2 && trades[2].GetAskTrade().quantity_ == 2
+        && trades[3].GetBidTrade().orderId_ == 10 && trades[3].GetAskTrade().orderId_ == 3 && trades[3].GetAskTrade().quantity_ == 3
+        && orderbook.Size() == 3;
+
+    orderbook.CancelOrder(12);
+    ok = ok && orderbook.Size() == 2;
+    if(!ok) {
+        std::cout << "stop orders triggered wrongly" << std::endl;
+    }
+    return ok;
+}
+
+// an uncross into the close leaves the stops pending instead of entering them into a book that takes no orders; the
+// next uncross into continuous trading sets them off
+template<typename Policy>
+bool TestStopsAcrossClose(Policy)
+{
+    BasicOrderbook<Policy> orderbook{LadderBand{95, 1, 10}};
+    Quantity uncrossed = 0;
+    auto count = [&uncrossed](const Trade& trade) { uncrossed += trade.GetBidTrade().quantity_; };
+    orderbook.OpenAuction();
+    orderbook.AddOrder(Order{OrderType::GoodTillCancel, 1, Side::Buy, 100, 5});
+    orderbook.AddOrder(Order{OrderType::GoodTillCancel, 2, Side::Sell, 100, 5});
+    orderbook.AddOrder(Order{OrderType::StopLimit, 3, Side::Buy, 101, 5, Constants::NoOwner, 0, 100});
+    auto result = orderbook.Uncross(TradeSink{count}, TradingPhase::Closed);
+    bool ok = result.volume_ == 5 && uncrossed == 5 && orderbook.GetPhase() == TradingPhase::Closed && orderbook.Size() == 1
+        && orderbook.GetOrderInfos().GetBids().empty();
+
+    orderbook.OpenAuction();
+    orderbook.AddOrder(Order{OrderType::GoodTillCancel, 4, Side::Sell, 100, 2});
+    orderbook.AddOrder(Order{OrderType::GoodTillCancel, 5, Side::Buy, 100, 2});
+    orderbook.Uncross(TradeSink{count});
+    auto bids = orderbook.GetOrderInfos().GetBids();
+    ok = ok && uncrossed == 7 && orderbook.Size() == 1 && bids.size() == 1 && bids[0].price_ == 101 && bids[0].quantity_ == 5;
+    if(!ok) {
+        std::cout << "stops were lost across the close" << std::endl;
+    }
+    return ok;
+}
+
+// the largest id is the index's empty-slot marker, but it is still an id like any other
+template<typename Policy>
+bool TestLargestOrderId(Policy)
+{
+    const OrderId largest = std::numeric_limits<OrderId>::max();
+    BasicOrderbook<Policy> orderbook{LadderBand{95, 1, 10}};
+    orderbook.CancelOrder(largest);
+    orderbook.ModifyOrder(OrderModify{largest, Side::Sell, 100, 5});
+    bool ok = orderbook.Size() == 0;
+
+    orderbook.AddOrder(Order{OrderType::GoodTillCancel, largest, Side::Sell, 100, 10});
+    orderbook.AddOrder(Order{OrderType::GoodTillCancel, largest, Side::Sell, 101, 10});
+    ok = ok && orderbook.Size() == 1 && orderbook.GetOrderInfos().GetAsks().size() == 1;
+
+    orderbook.ModifyOrder(OrderModify{largest, Side::Sell, 100, 4});
+    auto trades = orderbook.AddOrder(Order{OrderType::FillAndKill, 1, Side::Buy, 100, 10});
+    ok = ok && trades.size() == 1 && trades[0].GetAskTrade().orderId_ == largest && trades[0].GetAskTrade().quantity_ == 4
+        && orderbook.Size() == 0;
+
+    orderbook.AddOrder(Order{OrderType::GoodTillCancel, largest, Side::Buy, 99, 10});
+    orderbook.CancelOrder(largest);
+    orderbook.CancelOrder(largest);
+    ok = ok && orderbook.Size() == 0 && orderbook.GetOrderInfos().GetBids().empty();
+    if(!ok) {
+        std::cout << "largest order id mishandled" << std::endl;
+    }
+    return ok;
+}
+
+#if defined(ORDERBOOK_METRICS)
+// a short known session; every histogram and counter has to have seen exactly what it did
+bool TestMetrics()
+{
+    Orderbook orderbook{LadderBand{95, 1, 10}};
+    orderbook.AddOrder(Order{OrderType::GoodTillCancel, 1, Side::Sell, 100, 5});
+    orderbook.AddOrder(Order{OrderType::GoodTillCancel, 2, Side::Sell, 101, 5});
+    orderbook.AddOrder(Order{OrderType::GoodTillCancel, 3, Side::Buy, 99, 5});
+    //two fills across two levels, leaving nothing behind on either side
+    orderbook.AddOrder(Order{OrderType::GoodTillCancel, 4, Side::Buy, 101, 10});
+    orderbook.ModifyOrder(OrderModify{3, Side::Buy, 98, 5});
+    orderbook.CancelOrder(3);
+    //a self-match: a match pass without fills, and the resting order is cancelled
+    orderbook.AddOrder(Order{OrderType::GoodTillCancel, 5, Side::Sell, 100, 5, 7});
+    orderbook.AddOrder(Order{OrderType::GoodTillCancel, 6, Side::Buy, 100, 5, 7});
+
+    const auto& metrics = orderbook.GetMetrics();
+    bool ok = metrics.add_.Count() == 6 && metrics.cancel_.Count() == 1 && metrics.modify_.Count() == 1
+        && metrics.match_.Count() == 2 && metrics.fillsPerAggressor_.Max() == 2 && metrics.fillsPerAggressor_.Percentile(0.0) == 0
+        && metrics.levelsCreated_.Load() == 7 && metrics.levelsDestroyed_.Load() == 6 && metrics.maxSweepDepth_.Load() == 2
+        && metrics.selfMatches_.Load() == 1 && metrics.add_.Max() > 0 && metrics.add_.Percentile(0.5) <= metrics.add_.Max()
+        && CyclesPerNanosecond(std::chrono::milliseconds{1}) > 0;
+
+    //nested commands count once: the stop the print at 100 sets off goes through AddOrder inside the sell's add,
+    //and cancelling by modify runs CancelOrder inside the modify
+    orderbook.AddOrder(Order{OrderType::StopLimit, 7, Side::Buy, 102, 1, Constants::NoOwner, 0, 100});
+    orderbook.AddOrder(Order{OrderType::GoodTillCancel, 8, Side::Sell, 100, 1});
+    orderbook.ModifyOrder(OrderModify{6, Side::Buy, 100, 0});
+    ok = ok && orderbook.Size() == 1 && metrics.add_.Count() == 8 && metrics.cancel_.Count() == 1 && metrics.modify_.Count() == 2;
+    if(!ok) {
+        std::cout << "metrics counted wrongly" << std::endl;
+    }
+    return ok;
+}
+#endif
+
+// encodes one of each client message and decodes the stream fed in two uneven pieces, as reads would deliver it
+bool TestOrderEntryDecode()
+{
+    const OrderCommand commands[] = {
+        OrderCommand{CommandType::Add, OrderType::FillAndKill, Side::Sell, 42, 101, 7, 3},
+        OrderCommand{CommandType::Modify, OrderType::GoodTillCancel, Side::Buy, 42, 99, 5},
+        OrderCommand{CommandType::Cancel, OrderType::GoodTillCancel, Side::Buy, 42, 0, 0},
+        OrderCommand{CommandType::Add, OrderType::Iceberg, Side::Buy, 43, 99, 50, 3, 10},
+        OrderCommand{CommandType::Add, OrderType::StopLimit, Side::Sell, 44, 97, 20, 3, 0, 98},
+    };
+    std::byte wire[std::size(commands) * MaxCommandMessageSize];
+    std::size_t size = 0;
+    for(const auto& command : commands) {
+        size += EncodeCommand(command, wire + size);
+    }
+
+    std::vector<OrderCommand> decoded;
+    auto collect = [&decoded](const OrderCommand& command) { decoded.push_back(command); };
+    const std::size_t split = sizeof(EnterOrderMessage) + 5;
+    std::size_t consumed = DecodeOrderEntry(std::span<const std::byte>{wire, split}, collect);
+    consumed += DecodeOrderEntry(std::span<const std::byte>{wire + consumed, size - consumed}, collect);
+
+    bool same = consumed == size && decoded.size() == std::size(commands);
+    for(std::size_t i = 0; same && i < decoded.size(); ++i) {
+        const auto& expected = commands[i];
+        const auto& actual = decoded[i];
+        same = actual.type_ == expected.type_ && actual.orderId_ == expected.orderId_ && actual.quantity_ == expected.quantity_
+            && (expected.type_ == CommandType::Cancel || (actual.side_ == expected.side_ && actual.price_ == expected.price_))
+            && (expected.type_ != CommandType::Add || (actual.orderType_ == expected.orderType_ && actual.ownerId_ == expected.ownerId_
+                && actual.peakQuantity_ == expected.peakQuantity_ && actual.stopPrice_ == expected.stopPrice_));
+    }
+    if(!same) {
+        std::cout << "order entry messages did not round-trip" << std::endl;
+        return false;
+    }
+
+    //out-of-range fields and a bad length are refused outright, the length as soon as the header is in
+    auto rejected = [](const auto& message) {
+        std::byte bytes[MaxCommandMessageSize] = {};
+        std::memcpy(bytes, &message, sizeof(message));
+        try {
+            DecodeOrderEntry(std::span<const std::byte>{bytes, sizeof(message)}, [](const OrderCommand&) {});
+            return false;
+        }
+        catch(const std::runtime_error&) {
+            return true;
+        }
+    };
+    auto badSide = EnterOrderMessage::FromCommand(commands[0]);
+    badSide.side_ = 2;
+    auto badType = EnterOrderMessage::FromCommand(commands[0]);
+    badType.orderType_ = static_cast<std::uint8_t>(OrderType::StopLimit) + 1;
+    auto badReplace = ReplaceOrderMessage::FromCommand(commands[1]);
+    badReplace.side_ = 2;
+    auto emptyEnter = EnterOrderMessage::FromCommand(commands[0]);
+    emptyEnter.quantity_ = 0;
+    auto emptyReplace = ReplaceOrderMessage::FromCommand(commands[1]);
+    emptyReplace.quantity_ = 0;
+    bool ok = rejected(badSide) && rejected(badType) && rejected(badReplace) && rejected(emptyEnter) && rejected(emptyReplace)
+        && rejected(WireHeader{60000, EnterOrderMessage::Type, 0}) && rejected(WireHeader{16, 'Z', 0});
+    if(!ok) {
+        std::cout << "malformed order entry message accepted" << std::endl;
+    }
+    return ok;
+}
+
+// the same log replayed twice into a banded book and twice into a tree-only one has to trade and end up identically
+bool TestReplayDeterminism()
+{
+    const std::string path = "test_replay.evlog";
+    GenerateEventLog(path, 200'000, 3);
+    ReplayResult results[4];
+    {
+        EventLogReader reader{path};
+        for(int run = 0; run < 4; ++run) {
+            Orderbook banded{LadderBand{9'000, 1, 2'000}};
+            Orderbook treeOnly;
+            results[run] = Replay(reader.Records(), run % 2 ? treeOnly : banded);
+        }
+    }
+    std::remove(path.c_str());
+
+    bool ok = results[0].trades_ > 0;
+    for(const auto& result : results) {
+        ok = ok && result.events_ == 200'000 && result.trades_ == results[0].trades_
+            && result.tradeHash_ == results[0].tradeHash_ && result.bookHash_ == results[0].bookHash_;
+    }
+    if(!ok) {
+        std::cout << "replay was not deterministic" << std::endl;
+    }
+    return ok;
+}
+
+// journals a random session with a snapshot halfway through; recovering from the two has to rebuild the live book
+// order for order. then a torn record on the end is dropped on reopen, a torn header starts the journal over, and a
+// journal of another version (or not a journal at all) is refused rather than appended to
+bool TestJournalRecovery()
+{
+    const std::string journalPath = "test_recovery.journal";
+    const std::string snapshotPath = "test_recovery.snap";
+    std::remove(journalPath.c_str());
+    std::remove(snapshotPath.c_str());
+
+    const LadderBand band{90, 1, 20};
+    Orderbook live{band};
+    std::size_t trades = 0;
+    auto count = [&trades](const Trade&) { ++trades; };
+    TradeSink sink{count};
+    std::mt19937 rng{5};
+    const std::uint64_t commands = 4000, snapshotAt = 2500;
+    {
+        Journal journal{journalPath, 64};
+        OrderId orderId = 1;
+        for(std::uint64_t i = 0; i < commands; ++i) {
+            Side side = rng() % 2 ? Side::Buy : Side::Sell;
+            Price price = 90 + rng() % 20;
+            Quantity quantity = 1 + rng() % 20;
+            OrderCommand command{CommandType::Add, OrderType::GoodTillCancel, side, orderId++, price, quantity,
+                static_cast<OwnerId>(1 + rng() % 4)};
+            switch(rng() % 8) {
+                case 0:
+                    command = OrderCommand{CommandType::Cancel, OrderType::GoodTillCancel, side, 1 + rng() % orderId, 0, 0};
+                    break;
+                case 1:
+                    command = OrderCommand{CommandType::Modify, OrderType::GoodTillCancel, side, 1 + rng() % orderId, price, quantity};
+                    break;
+                case 2:
+                    command.orderType_ = OrderType::Iceberg;
+                    command.quantity_ *= 3;
+                    command.peakQuantity_ = quantity;
+                    break;
+                case 3:
+                    command.orderType_ = OrderType::StopLimit;
+                    command.stopPrice_ = 90 + rng() % 20;
+                    break;
+                case 4:
+                    command.orderType_ = OrderType::GoodForDay;
+                    break;
+            }
+            //session changes on both sides of the snapshot: it is taken mid-auction, and the uncross is replayed
+            switch(i) {
+                case 1000:
+                    command = OrderCommand::Session(CommandType::SetSessionEnd, 3500);
+                    break;
+                case 1500:
+                    command = OrderCommand::Session(CommandType::SetSelfMatchPolicy, static_cast<std::int64_t>(SelfMatchPolicy::DecrementBoth));
+                    break;
+                case 2300:
+                    command = OrderCommand::Session(CommandType::OpenAuction);
+                    break;
+                case 2400:
+                    command = OrderCommand::Session(CommandType::SetReferencePrice, 99);
+                    break;
+                case 2700:
+                    command = OrderCommand::Session(CommandType::Uncross, static_cast<std::int64_t>(TradingPhase::Continuous));
+                    break;
+                case 3000:
+                    command = OrderCommand::Session(CommandType::SetSelfMatchPolicy, static_cast<std::int64_t>(SelfMatchPolicy::CancelAggressor));
+                    break;
+                case 3800:
+                    command = OrderCommand::Session(CommandType::CloseBook);
+                    break;
+            }
+            Timestamp now = static_cast<Timestamp>(i);
+            journal.Append(now, command);
+            live.ExpireOrders(now);
+            live.Apply(command, sink);
+            if(i + 1 == snapshotAt) {
+                journal.Commit();
+                WriteSnapshot(live, journal.Sequence(), snapshotPath);
+            }
+        }
+    }
+
+    auto orders = [](const Orderbook& book) {
+        std::vector<std::tuple<OrderId, Side, Price, Quantity, Quantity, Price>> result;
+        book.ForEachOrder([&result](const Order& order, Timestamp) {
+            result.emplace_back(order.GetOrderId(), order.GetSide(), order.GetPrice(), order.GetRemainingQuantity(),
+                order.GetDisplayQuantity(), order.GetStopPrice());
+        });
+        return result;
+    };
+    auto same = [&orders](const Orderbook& book, const Orderbook& live) {
+        return orders(book) == orders(live) && book.GetTopOfBook().SameLevels(live.GetTopOfBook()) && HashBook(book) == HashBook(live)
+            && book.GetPhase() == live.GetPhase() && book.GetSessionEnd() == live.GetSessionEnd()
+            && book.GetSelfMatchPolicy() == live.GetSelfMatchPolicy() && book.GetReferencePrice() == live.GetReferencePrice();
+    };
+    Orderbook recovered{band};
+    auto recovery = Recover(recovered, snapshotPath, journalPath);
+    bool ok = trades > 0 && live.GetPhase() == TradingPhase::Closed && recovery.snapshotSequence_ == snapshotAt
+        && recovery.journalReplayed_ == commands - snapshotAt && same(recovered, live);
+
+    //the journal alone goes through the same session changes
+    Orderbook replayed{band};
+    recovery = Recover(replayed, "test_recovery.missing", journalPath);
+    ok = ok && recovery.snapshotSequence_ == 0 && recovery.journalReplayed_ == commands && same(replayed, live);
+
+    auto appendBytes = [](const std::string& path, const void* data, std::size_t size) {
+        std::FILE* file = std::fopen(path.c_str(), "ab");
+        std::fwrite(data, 1, size, file);
+        std::fclose(file);
+    };
+    auto opens = [](const std::string& path) {
+        try {
+            Journal journal{path};
+            return true;
+        }
+        catch(const std::runtime_error&) {
+            return false;
+        }
+    };
+
+    //a crash half-way through a record: it is dropped and the next one lands straight after the last whole one
+    appendBytes(journalPath, "torn!", 5);
+    {
+        Journal journal{journalPath};
+        ok = ok && journal.Sequence() == commands;
+        journal.Append(0, OrderCommand{CommandType::Cancel, OrderType::GoodTillCancel, Side::Buy, 424242, 0, 0});
+    }
+    {
+        EventLogReader reader{journalPath};
+        ok = ok && reader.Records().size() == commands + 1 && reader.Records().back().orderId_ == 424242;
+    }
+
+    //a record whose enum bytes are out of range stops replay and recovery instead of reaching the book
+    EventRecord corrupt = EventRecord::FromCommand(0, OrderCommand{CommandType::Add, OrderType::GoodTillCancel, Side::Buy, 424243, 100, 1});
+    auto replayRejects = [](const EventRecord& record) {
+        Orderbook book;
+        try {
+            Replay(std::span<const EventRecord>{&record, 1}, book);
+            return false;
+        }
+        catch(const std::runtime_error&) {
+            return book.Size() == 0;
+        }
+    };
+    corrupt.side_ = 2;
+    ok = ok && replayRejects(corrupt);
+    corrupt.side_ = 0;
+    corrupt.orderType_ = static_cast<std::uint8_t>(OrderType::StopLimit) + 1;
+    ok = ok && replayRejects(corrupt);
+    corrupt.orderType_ = 0;
+    corrupt.commandType_ = static_cast<std::uint8_t>(CommandType::SetReferencePrice) + 1;
+    ok = ok && replayRejects(corrupt);
+    ok = ok && replayRejects(EventRecord::FromCommand(0, OrderCommand::Session(CommandType::Uncross, 3)));
+    ok = ok && replayRejects(EventRecord::FromCommand(0, OrderCommand::Session(CommandType::SetSelfMatchPolicy, 3)));
+    {
+        Journal journal{journalPath};
+        journal.Append(0, OrderCommand{CommandType::Modify, OrderType::GoodTillCancel, static_cast<Side>(9), 1, 100, 1});
+    }
+    try {
+        Orderbook book{band};
+        Recover(book, snapshotPath, journalPath);
+        ok = false;
+    }
+    catch(const std::runtime_error&) {
+    }
+
+    //a crash while writing the header leaves a prefix of it, which starts over; anything else is refused
+    std::remove(journalPath.c_str());
+    appendBytes(journalPath, EventLogMagic, 5);
+    {
+        Journal journal{journalPath};
+        ok = ok && journal.Sequence() == 0;
+    }
+    ok = ok && EventLogReader{journalPath}.Records().empty();
+
+    std::remove(journalPath.c_str());
+    appendBytes(journalPath, "hello", 5);
+    ok = ok && !opens(journalPath);
+
+    EventLogHeader old{};
+    std::memcpy(old.magic_, EventLogMagic, sizeof(old.magic_));
+    old.version_ = 1;
+    old.recordSize_ = 32;
+    const std::byte record[32] = {};
+    std::remove(journalPath.c_str());
+    appendBytes(journalPath, &old, sizeof(old));
+    appendBytes(journalPath, record, sizeof(record));
+    ok = ok && !opens(journalPath);
+
+    std::remove(journalPath.c_str());
+    std::remove(snapshotPath.c_str());
+    if(!ok) {
+        std::cout << "journal recovery diverged from the live book" << std::endl;
+    }
+    return ok;
+}
+
+// gateways push one-lot buys against a sell that never runs dry and the matcher is stopped straight after: every
+// command queued before Stop has to come back as a trade, and each gateway's trades in the order it pushed them
+bool TestMatchingThread()
+{
+    constexpr std::size_t Producers = 3;
+    constexpr std::size_t PerProducer = 3000;
+    MatchingThread matcher{Producers, 1 << 14, LadderBand{95, 1, 10}};
+    matcher.Book().AddOrder(Order{OrderType::GoodTillCancel, 1, Side::Sell, 100, 1u << 30});
+    matcher.Start();
+
+    std::vector<std::thread> gateways;
+    for(std::size_t p = 0; p < Producers; ++p) {
+        gateways.emplace_back([&matcher, p] {
+            for(std::size_t i = 0; i < PerProducer; ++i) {
+                OrderId orderId = (p + 1) * 1'000'000 + i;
+                matcher.Ingress(p).Push(OrderCommand{CommandType::Add, OrderType::GoodTillCancel, Side::Buy, orderId, 100, 1});
+            }
+        });
+    }
+    for(auto& gateway : gateways) {
+        gateway.join();
+    }
+    matcher.Stop();
+
+    OrderId next[Producers] = {};
+    std::size_t trades = 0;
+    bool ordered = true;
+    Trade trade;
+    while(matcher.Outbound().TryPop(trade)) {
+        OrderId orderId = trade.GetBidTrade().orderId_;
+        std::size_t producer = orderId / 1'000'000 - 1;
+        ordered = ordered && producer < Producers && orderId % 1'000'000 == next[producer]++;
+        ++trades;
+    }
+    bool ok = ordered && trades == Producers * PerProducer && matcher.CommandsProcessed() == Producers * PerProducer
+        && matcher.Book().Size() == 1;
+    if(!ok) {
+        std::cout << "matching thread lost or reordered commands" << std::endl;
+    }
+    return ok;
+}
+
+// every instrument gets the same order ids and a different number of one-lot buys against its own resting sell:
+// trades have to come out of the shard that owns the instrument and only ever eat into that instrument's book
+bool TestShardedEngine()
+{
+    constexpr std::size_t Shards = 3;
+    constexpr InstrumentId Instruments = 9;
+    ShardedEngine engine{Shards, 2, 1024};
+    for(InstrumentId instrument = 0; instrument < Instruments; ++instrument) {
+        engine.AddInstrument(instrument, LadderBand{95, 1, 10});
+        engine.Book(instrument)->AddOrder(Order{OrderType::GoodTillCancel, 1, Side::Sell, 100, 100});
+    }
+    bool ok = engine.ShardOf(4) == 1 && engine.ShardOf(8) == 2 && engine.Book(Instruments) == nullptr;
+    engine.Start();
+
+    //instrument i gets i + 1 buys, split between the two producers; the unknown instrument is rejected
+    for(InstrumentId instrument = 0; instrument < Instruments; ++instrument) {
+        for(OrderId orderId = 2; orderId < instrument + 3; ++orderId) {
+            engine.Submit(orderId % 2, instrument, OrderCommand{CommandType::Add, OrderType::GoodTillCancel, Side::Buy, orderId, 100, 1});
+        }
+    }
+    engine.Submit(0, Instruments, OrderCommand{CommandType::Add, OrderType::GoodTillCancel, Side::Buy, 2, 100, 1});
+    engine.Stop();
+
+    std::size_t trades[Instruments] = {};
+    std::uint64_t rejected = 0;
+    InstrumentTrade trade;
+    for(std::size_t shard = 0; shard < Shards; ++shard) {
+        while(engine.Outbound(shard).TryPop(trade)) {
+            ok = ok && engine.ShardOf(trade.instrumentId_) == shard && trade.trade_.GetAskTrade().orderId_ == 1;
+            ++trades[trade.instrumentId_ % Instruments];
+        }
+        auto stats = engine.GetShardStats(shard);
+        ok = ok && stats.books_ == Instruments / Shards;
+        rejected += stats.commandsRejected_;
+    }
+    for(InstrumentId instrument = 0; instrument < Instruments; ++instrument) {
+        auto asks = engine.Book(instrument)->GetOrderInfos().GetAsks();
+        ok = ok && trades[instrument] == instrument + 1 && asks.size() == 1 && asks[0].quantity_ == 100 - (instrument + 1);
+    }
+    ok = ok && rejected == 1;
+    if(!ok) {
+        std::cout << "sharded engine routed commands wrongly" << std::endl;
+    }
+    return ok;
+}
+
+// runs a test once per policy the library instantiates
+template<typename Test>
+bool ForEachPolicy(Test test)
+{
+    return test(DefaultOrderbookPolicy{}) && test(LockedOrderbookPolicy{}) && test(StdIndexOrderbookPolicy{});
+}
+
 int main()
 {
     Orderbook orderbook;
@@ -33,5 +1012,112 @@ int main()
     orderbook.CancelOrder(orderId);
 
     std::cout << orderbook.Size() << std::endl;
+
+    if(!ForEachPolicy([](auto policy) { return TestFillOrKill(policy); })) {
+        return 1;
+    }
+    std::cout << "FillOrKill ok" << std::endl;
+
+    if(!ForEachPolicy([](auto policy) { return TestGoodForDayExpiry(policy); })) {
+        return 1;
+    }
+    std::cout << "GoodForDay expiry ok" << std::endl;
+
+    if(!ForEachPolicy([](auto policy) { return TestMarketDataFeed(policy); })) {
+        return 1;
+    }
+    std::cout << "market data feed ok" << std::endl;
+
+    if(!TestTopOfBookCell()) {
+        return 1;
+    }
+    std::cout << "top of book cell ok" << std::endl;
+
+    if(!ForEachPolicy([](auto policy) { return TestDepthSpans(policy); })) {
+        return 1;
+    }
+    std::cout << "depth spans ok" << std::endl;
+
+    if(!ForEachPolicy([](auto policy) { return TestModifyPriority(policy); })) {
+        return 1;
+    }
+    std::cout << "modify priority ok" << std::endl;
+
+    if(!ForEachPolicy([](auto policy) { return TestSelfMatch(policy); })) {
+        return 1;
+    }
+    std::cout << "self-match prevention ok" << std::endl;
+
+    if(!ForEachPolicy([](auto policy) { return TestMarketOrder(policy); })) {
+        return 1;
+    }
+    std::cout << "market orders ok" << std::endl;
+
+    if(!ForEachPolicy([](auto policy) { return TestAuction(policy); })) {
+        return 1;
+    }
+    std::cout << "auction ok" << std::endl;
+
+    if(!ForEachPolicy([](auto policy) { return TestBatchEntry(policy); })) {
+        return 1;
+    }
+    std::cout << "batch entry ok" << std::endl;
+
+    if(!ForEachPolicy([](auto policy) { return TestBatchStopsInAuction(policy); })) {
+        return 1;
+    }
+    std::cout << "batch stops in an auction ok" << std::endl;
+
+    if(!ForEachPolicy([](auto policy) { return TestIceberg(policy); })) {
+        return 1;
+    }
+    std::cout << "iceberg orders ok" << std::endl;
+
+    if(!ForEachPolicy([](auto policy) { return TestStopOrders(policy); })) {
+        return 1;
+    }
+    std::cout << "stop orders ok" << std::endl;
+
+    if(!ForEachPolicy([](auto policy) { return TestStopsAcrossClose(policy); })) {
+        return 1;
+    }
+    std::cout << "stops across the close ok" << std::endl;
+
+    if(!ForEachPolicy([](auto policy) { return TestLargestOrderId(policy); })) {
+        return 1;
+    }
+    std::cout << "largest order id ok" << std::endl;
+
+    if(!TestReplayDeterminism()) {
+        return 1;
+    }
+    std::cout << "replay determinism ok" << std::endl;
+
+    if(!TestJournalRecovery()) {
+        return 1;
+    }
+    std::cout << "journal recovery ok" << std::endl;
+
+    if(!TestMatchingThread()) {
+        return 1;
+    }
+    std::cout << "matching thread ok" << std::endl;
+
+    if(!TestShardedEngine()) {
+        return 1;
+    }
+    std::cout << "sharded engine ok" << std::endl;
+
+#if defined(ORDERBOOK_METRICS)
+    if(!TestMetrics()) {
+        return 1;
+    }
+    std::cout << "metrics ok" << std::endl;
+#endif
+
+    if(!TestOrderEntryDecode()) {
+        return 1;
+    }
+    std::cout << "order entry decode ok" << std::endl;
     return 0;
 }
\ No newline at end of file